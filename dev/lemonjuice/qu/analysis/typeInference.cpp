@@ -0,0 +1,41 @@
+#include "typeInference.h"
+
+#include <vector>
+#include "../compiler/compiler.h"
+
+using namespace std;
+
+/**
+ * Checks whether an instruction can put a string on the queue.
+ *
+ * @param opcode The instruction's opcode.
+ * @return true if it can.
+ */
+static bool makesStrings(Opcode opcode) {
+    return opcode == Opcode::PushString || opcode == Opcode::Read || opcode == Opcode::ReadAll;
+}
+
+/**
+ * Proves that a program only ever holds integers, as long as its queue starts out with nothing but integers.
+ * Instructions that can't be reached by falling through from the start or by a jump don't count, so a string pushed by
+ * dead code doesn't keep the rest of the program off the integer engine.
+ *
+ * @param program The program.
+ * @return true if no instruction that can run puts a string on the queue.
+ */
+bool TypeInference::integerOnly(const Program& program) {
+    vector<bool> reachable(program.code.size(), false);
+    vector<size_t> pending = {0};
+    while (!pending.empty()) {
+        size_t index = pending.back();
+        pending.pop_back();
+        if (reachable[index]) continue;
+        reachable[index] = true;
+
+        const Instruction& instruction = program.code[index];
+        if (makesStrings(instruction.opcode)) return false;
+        if (Compiler::isJump(instruction.opcode)) pending.push_back(static_cast<size_t>(instruction.int_operand));
+        if (instruction.opcode != Opcode::Goto && instruction.opcode != Opcode::Ret && instruction.opcode != Opcode::Halt) pending.push_back(index + 1);
+    }
+    return true;
+}
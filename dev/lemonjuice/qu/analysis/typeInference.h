@@ -0,0 +1,15 @@
+#pragma once
+
+#include "../compiler/instruction.h"
+
+/**
+ * Works out what kinds of value a program's queue can ever hold.
+ *
+ * Only three instructions put a string on the queue: a PUSH of a quoted string, READ and READALL. Every other instruction
+ * makes integers from integers (ADD only joins strings when one of its operands already is one), so a program that can't
+ * reach any of the three never holds anything but integers, and can run on the IntExecutor.
+ */
+class TypeInference {
+public:
+    static bool integerOnly(const Program& program);
+};
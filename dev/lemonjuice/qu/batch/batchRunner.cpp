@@ -0,0 +1,266 @@
+#include "batchRunner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "../bytecode/bytecodeFile.h"
+#include "../compiler/compiler.h"
+#include "../input/inputReader.h"
+#include "../interpreter/interpreter.h"
+#include "../optimizer/optimizer.h"
+#include "../output/queueWriter.h"
+#include "../source/sourceFile.h"
+#ifdef _WIN32
+#define fileno _fileno
+static const char* const NULL_DEVICE = "NUL";
+#else
+static const char* const NULL_DEVICE = "/dev/null";
+#endif
+
+using namespace std;
+
+// A line of the manifest.
+struct BatchJob {
+    int line;
+    string program;
+    string input;  // Empty for no input.
+    string output; // Empty to throw the output away.
+    size_t program_index = 0; // The program's entry in the list of distinct programs.
+};
+
+// How a job went.
+struct BatchResult {
+    bool ran = false;
+    int exit_code = 0;
+    double seconds = 0;
+    std::string error; // Why the job couldn't run or what stopped it, empty if it ran to the end.
+};
+
+/**
+ * Calls a function once for every index below a count, on up to the given number of threads.
+ * Each thread takes the next index as soon as it is done with its last one.
+ *
+ * @param count The number of indexes.
+ * @param threads The most threads to use.
+ * @param work The function, called with the index of the thread and the index of the work.
+ */
+template <typename Work>
+static void forEachParallel(size_t count, unsigned threads, Work work) {
+    atomic<size_t> next(0);
+    auto worker = [&](unsigned thread_index) {
+        for (size_t index = next++; index < count; index = next++) work(thread_index, index);
+    };
+    if (threads > count) threads = static_cast<unsigned>(count);
+    vector<thread> workers;
+    for (unsigned i = 1; i < threads; i++) workers.emplace_back(worker, i);
+    worker(0); // The calling thread works too.
+    for (thread& other : workers) other.join();
+}
+
+/**
+ * Reads the manifest into jobs.
+ *
+ * @param manifest The manifest.
+ * @param jobs Receives a job for every program line.
+ */
+static void readManifest(const SourceFile& manifest, vector<BatchJob>& jobs) {
+    const vector<string_view>& lines = manifest.lines();
+    for (size_t i = 0; i < lines.size(); i++) {
+        vector<string> fields;
+        string_view rest = lines[i];
+        while (true) {
+            size_t start = rest.find_first_not_of(" \t\r");
+            if (start == string_view::npos) break;
+            rest.remove_prefix(start);
+            size_t end = rest.find_first_of(" \t\r");
+            fields.emplace_back(rest.substr(0, end));
+            if (end == string_view::npos) break;
+            rest.remove_prefix(end);
+        }
+        if (fields.empty() || fields[0][0] == '#') continue;
+
+        BatchJob job{static_cast<int>(i + 1), fields[0], "", ""};
+        if (fields.size() > 1 && fields[1] != "-") job.input = fields[1];
+        if (fields.size() > 2 && fields[2] != "-") job.output = fields[2];
+        jobs.push_back(std::move(job));
+    }
+}
+
+/**
+ * Compiles (or loads, for a .quc file) a program of the batch.
+ *
+ * @param path The program's file.
+ * @param optimization_level How far to optimize a program that is compiled here.
+ * @param error Receives why the program couldn't be loaded.
+ * @return The program ready to share, or null if it couldn't be loaded.
+ */
+static shared_ptr<const Program> loadProgram(const string& path, int optimization_level, string& error) {
+    SourceFile file;
+    if (!file.open(path)) {
+        error = "could not read program";
+        return nullptr;
+    }
+    Program program;
+    if (path.size() > 4 && path.compare(path.size() - 4, 4, ".quc") == 0) {
+        uint64_t source_hash = 0;
+        if (!BytecodeFile::load(file.text(), program, source_hash)) {
+            error = "invalid compiled program";
+            return nullptr;
+        }
+    }
+    else {
+        errorHandler error_handler(ErrorPolicy::Return);
+        program = Compiler::compile(file.lines(), error_handler);
+        if (error_handler.failed()) {
+            error = error_handler.getMessage();
+            return nullptr;
+        }
+        Optimizer::optimize(program, optimization_level);
+    }
+    return Interpreter::prepare(std::move(program));
+}
+
+/**
+ * Runs a single job.
+ *
+ * @param interpreter The interpreter of the thread running the job.
+ * @param job The job.
+ * @return How it went.
+ */
+static BatchResult runJob(Interpreter& interpreter, const BatchJob& job) {
+    BatchResult result;
+    auto start = chrono::steady_clock::now();
+
+    FILE* input_file = nullptr;
+    if (!job.input.empty()) {
+        input_file = fopen(job.input.c_str(), "rb");
+        if (input_file == nullptr) {
+            result.error = "could not open input";
+            return result;
+        }
+    }
+    FILE* output_file = fopen(job.output.empty() ? NULL_DEVICE : job.output.c_str(), "wb");
+    if (output_file == nullptr) {
+        if (input_file != nullptr) fclose(input_file);
+        result.error = "could not open output";
+        return result;
+    }
+
+    {
+        InputReader input = input_file != nullptr ? InputReader(fileno(input_file)) : InputReader(string_view());
+        OutputSink output(output_file);
+        result.exit_code = interpreter.run(input, output);
+        result.ran = true;
+    }
+    if (interpreter.failed()) result.error = interpreter.getErrorMessage();
+    if (input_file != nullptr) fclose(input_file);
+    fclose(output_file);
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+/**
+ * Writes a number of seconds with microsecond precision.
+ */
+static void writeSeconds(OutputSink& out, double seconds) {
+    char digits[32];
+    int length = snprintf(digits, sizeof(digits), "%.6f", seconds);
+    out.write(string_view(digits, static_cast<size_t>(length)));
+}
+
+/**
+ * Runs every program in a manifest.
+ *
+ * @param manifest_path The manifest file.
+ * @param options How to run the programs.
+ * @param summary Where the JSON summary goes.
+ * @return true if the manifest was read, false if it couldn't be opened.
+ */
+bool BatchRunner::run(const string& manifest_path, const BatchOptions& options, OutputSink& summary) {
+    SourceFile manifest;
+    if (!manifest.open(manifest_path)) return false;
+    vector<BatchJob> jobs;
+    readManifest(manifest, jobs);
+    unsigned threads = options.threads != 0 ? options.threads : max(1u, thread::hardware_concurrency());
+    auto start = chrono::steady_clock::now();
+
+    // Every distinct program is compiled once, in parallel, before anything runs.
+    map<string, size_t> program_indexes;
+    vector<string> program_paths;
+    for (BatchJob& job : jobs) {
+        auto found = program_indexes.emplace(job.program, program_paths.size());
+        if (found.second) program_paths.push_back(job.program);
+        job.program_index = found.first->second;
+    }
+    vector<shared_ptr<const Program>> programs(program_paths.size());
+    vector<string> program_errors(program_paths.size());
+    forEachParallel(program_paths.size(), threads, [&](unsigned, size_t index) {
+        programs[index] = loadProgram(program_paths[index], options.optimization_level, program_errors[index]);
+    });
+
+    // One interpreter per thread, each reused for every job the thread takes.
+    vector<Interpreter> interpreters(min<size_t>(threads, max<size_t>(jobs.size(), 1)));
+    for (Interpreter& interpreter : interpreters) {
+        interpreter.setDispatchMode(options.dispatch_mode);
+        interpreter.setJit(options.jit);
+    }
+    vector<BatchResult> results(jobs.size());
+    forEachParallel(jobs.size(), threads, [&](unsigned thread_index, size_t index) {
+        const shared_ptr<const Program>& program = programs[jobs[index].program_index];
+        if (program == nullptr) {
+            results[index].error = program_errors[jobs[index].program_index];
+            return;
+        }
+        Interpreter& interpreter = interpreters[thread_index];
+        interpreter.load(program);
+        if (options.seeded) interpreter.seed(options.seed); // Every job repeats exactly, whichever thread runs it.
+        results[index] = runJob(interpreter, jobs[index]);
+    });
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    size_t failed = 0;
+    for (const BatchResult& result : results) {
+        if (!result.error.empty() || result.exit_code != 0) failed++;
+    }
+    summary.write("{\n  \"jobs\": ");
+    summary.writeInt(static_cast<int64_t>(jobs.size()));
+    summary.write(",\n  \"threads\": ");
+    summary.writeInt(threads);
+    summary.write(",\n  \"programs\": ");
+    summary.writeInt(static_cast<int64_t>(program_paths.size()));
+    summary.write(",\n  \"failed\": ");
+    summary.writeInt(static_cast<int64_t>(failed));
+    summary.write(",\n  \"seconds\": ");
+    writeSeconds(summary, seconds);
+    summary.write(",\n  \"results\": [");
+    for (size_t i = 0; i < jobs.size(); i++) {
+        summary.write(i == 0 ? "\n    {\"line\": " : ",\n    {\"line\": ");
+        summary.writeInt(jobs[i].line);
+        summary.write(", \"program\": ");
+        QueueWriter::writeJsonString(summary, jobs[i].program);
+        if (!results[i].ran) {
+            summary.write(", \"error\": ");
+            QueueWriter::writeJsonString(summary, results[i].error);
+        }
+        else {
+            summary.write(", \"exitCode\": ");
+            summary.writeInt(results[i].exit_code);
+            summary.write(", \"seconds\": ");
+            writeSeconds(summary, results[i].seconds);
+            if (!results[i].error.empty()) {
+                summary.write(", \"error\": ");
+                QueueWriter::writeJsonString(summary, results[i].error);
+            }
+        }
+        summary.write("}");
+    }
+    summary.write("\n  ]\n}");
+    summary.endLine();
+    return true;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "../executor/executor.h"
+#include "../output/outputSink.h"
+
+/**
+ * How every program of a batch is run.
+ */
+struct BatchOptions {
+    unsigned threads = 0;       // Programs run at once, 0 for one per hardware thread.
+    int optimization_level = 0;
+    DispatchMode dispatch_mode = QU_THREADED_DISPATCH ? DispatchMode::Threaded : DispatchMode::Switch;
+    bool jit = false;
+    bool seeded = false;        // Whether every program's POKE starts from seed, rather than from the system.
+    uint64_t seed = 0;
+};
+
+/**
+ * Runs a whole batch of programs in one process for --batch, several at a time on a pool of threads.
+ *
+ * The manifest lists one program per line, as "program [input [output]]" separated by whitespace. The program reads its
+ * input from the input file and writes its output to the output file, "-" or a missing file meaning no input or output
+ * that is thrown away. Blank lines and lines starting with '#' are skipped.
+ *
+ * Every program is compiled once however often it appears, and each thread runs the programs it takes with an Interpreter
+ * of its own. Threads take the next program in the manifest whenever they finish one, so a few slow programs don't hold
+ * up the rest. When everything has run, a JSON summary of every program's exit code and time is written.
+ */
+class BatchRunner {
+public:
+    static bool run(const std::string& manifest_path, const BatchOptions& options, OutputSink& summary);
+};
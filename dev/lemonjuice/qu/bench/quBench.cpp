@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../analysis/typeInference.h"
+#include "../compiler/compiler.h"
+#include "../error/errorHandler.h"
+#include "../executor/executor.h"
+#include "../input/inputReader.h"
+#include "../node/node.h"
+#include "../node/stringArena.h"
+#include "../operation/operationHandler.h"
+#include "../output/outputSink.h"
+#include "../queue/ringQueue.h"
+#include "../random/randomSource.h"
+#ifdef _WIN32
+#define fileno _fileno
+#endif
+
+using namespace std;
+
+/**
+ * The benchmark suite: a set of generated programs that each lean on one part of the interpreter,
+ * and a microbenchmark of every OperationHandler operation. Results are written to stdout as JSON.
+ *
+ * Options:
+ *   --scale=F   Multiplies the size of every workload (default 1).
+ *   --repeat=N  Runs everything N times and reports the fastest run (default 5).
+ */
+
+// A generated program and what it takes to run it.
+struct Workload {
+    string name;
+    vector<string> lines;
+    string input;          // What the program reads from its input.
+    uint64_t size;         // Loop iterations, elements or lines, whatever the workload is made of.
+    uint64_t instructions; // The number of instructions one run executes.
+    bool jit = false;      // Whether hot loops are compiled to native code.
+    bool tagged = false;   // Whether to stay on the node queue even if the program only holds integers.
+};
+
+struct Result {
+    string name;
+    uint64_t size;
+    uint64_t instructions;
+    double compile_seconds;
+    double seconds;
+};
+
+static double secondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * A counting loop, driven by IFGT and the jump back to the top.
+ */
+static Workload countingLoop(uint64_t iterations) {
+    Workload workload{"counting_loop", {}, "", iterations, 3 + 5 * iterations};
+    workload.lines = {"PUSH " + to_string(iterations), "PUSH 0", "|LOOP|", "ADD", "PUSH 1", "SUB", "PUSH 0", "IFGT LOOP", "RET"};
+    return workload;
+}
+
+/**
+ * A counting loop in the other common shape: an IFEQ at the top leaves it, and a GOTO at the bottom jumps back.
+ */
+static Workload gotoLoop(uint64_t iterations) {
+    Workload workload{"goto_loop", {}, "", iterations, 4 + 6 * iterations};
+    workload.lines = {"PUSH " + to_string(iterations), "PUSH 0", "|LOOP|", "IFEQ DONE", "ADD", "PUSH 1", "SUB", "PUSH 0", "GOTO LOOP", "|DONE|", "RET"};
+    return workload;
+}
+
+/**
+ * Builds one long string by repeatedly ADDing pieces to it, then prints it.
+ */
+static Workload stringAccumulation(uint64_t pieces) {
+    Workload workload{"string_add", {}, "", pieces, 2 + 2 * pieces};
+    workload.lines.push_back("PUSH \"start of a long line\"");
+    for (uint64_t i = 0; i < pieces; i++) {
+        workload.lines.push_back("PUSH \"piece " + to_string(i) + ";\"");
+        workload.lines.push_back("ADD");
+    }
+    workload.lines.push_back("POP");
+    return workload;
+}
+
+/**
+ * SORTUP on a large queue of integers mixed with strings.
+ */
+static Workload sortLargeQueue(uint64_t elements) {
+    Workload workload{"sortup", {}, "", elements, elements + 2};
+    RandomSource random(elements);
+    for (uint64_t i = 0; i < elements; i++) {
+        int64_t value = static_cast<int64_t>(random.below(2000000)) - 1000000;
+        if (i % 3 == 2) workload.lines.push_back("PUSH \"s" + to_string(value) + "\"");
+        else workload.lines.push_back("PUSH " + to_string(value));
+    }
+    workload.lines.push_back("SORTUP");
+    workload.lines.push_back("RET");
+    return workload;
+}
+
+/**
+ * A loop of every K operation, each iteration folding its results back down to the counter.
+ */
+static Workload kOperations(uint64_t iterations) {
+    Workload workload{"k_ops", {}, "", iterations, 3 + 11 * iterations};
+    workload.lines = {"PUSH " + to_string(iterations + 1), "PUSH 1", "|LOOP|",
+                      "ADDK", "SUBK", "MULK", "DIVK", "MODK",
+                      "SUB", "SUB", "DIV", "ADD", "SUB",
+                      "IFGT LOOP", "RET"};
+    return workload;
+}
+
+/**
+ * READALL over a large input of integers and words.
+ */
+static Workload readIngest(uint64_t input_lines) {
+    Workload workload{"read_ingest", {"READALL \"\"", "RET"}, "", input_lines, 2};
+    for (uint64_t i = 0; i < input_lines; i++) {
+        if (i % 4 == 3) workload.input += "word" + to_string(i) + "\n";
+        else workload.input += to_string(i * 7919) + "\n";
+    }
+    return workload;
+}
+
+/**
+ * The same workload, run with --jit.
+ */
+static Workload jitted(Workload workload) {
+    workload.name += "_jit";
+    workload.jit = true;
+    return workload;
+}
+
+/**
+ * The same workload, kept off the integer engine to compare against it.
+ */
+static Workload tagged(Workload workload) {
+    workload.name += "_tagged";
+    workload.tagged = true;
+    return workload;
+}
+
+/**
+ * Compiles a workload and runs it, keeping the fastest of several runs.
+ */
+static Result runWorkload(const Workload& workload, int repeat) {
+    errorHandler error_handler;
+    vector<string_view> lines(workload.lines.begin(), workload.lines.end());
+    auto start = chrono::steady_clock::now();
+    Program program = Compiler::compile(lines, error_handler);
+    double compile_seconds = secondsSince(start);
+    DispatchMode mode = QU_THREADED_DISPATCH ? DispatchMode::Threaded : DispatchMode::Switch;
+    if (mode == DispatchMode::Threaded) Executor::bindHandlers(program);
+    program.integer_only = !workload.tagged && TypeInference::integerOnly(program);
+
+    double best = 0;
+    for (int run = 0; run < repeat; run++) {
+        FILE* input_file = tmpfile();
+        if (input_file == nullptr) {
+            perror("tmpfile");
+            exit(1);
+        }
+        fwrite(workload.input.data(), 1, workload.input.size(), input_file);
+        fflush(input_file);
+        rewind(input_file);
+
+        StringArena arena; // Like an Interpreter's, declared first so it outlives the strings on the queue.
+        StringArena::Scope arena_scope(arena);
+        RingQueue<node> program_queue;
+        InputReader input(fileno(input_file));
+        string captured;
+        RandomSource random(run);
+        start = chrono::steady_clock::now();
+        {
+            OutputSink output(captured);
+            Executor::run(program, program_queue, error_handler, input, output, random, mode, false, nullptr, workload.jit);
+        }
+        double seconds = secondsSince(start);
+        if (run == 0 || seconds < best) best = seconds;
+        fclose(input_file);
+    }
+    return {workload.name, workload.size, workload.instructions, compile_seconds, best};
+}
+
+/**
+ * Times one OperationHandler operation on integers (or strings), including pushing its operands and popping its result.
+ */
+static Result benchmarkOperation(const string& name, bool (*operation)(RingQueue<node>&, int, errorHandler&), bool keeps_operands, node first, node second, uint64_t iterations, int repeat) {
+    errorHandler error_handler;
+    double best = 0;
+    for (int run = 0; run < repeat; run++) {
+        RingQueue<node> program_queue;
+        auto start = chrono::steady_clock::now();
+        if (keeps_operands) {
+            // K operations leave their operands at the front, so the queue only needs clearing now and then.
+            for (uint64_t i = 0; i < iterations; i++) {
+                if ((i & 1023) == 0) {
+                    program_queue.clear();
+                    program_queue.push(first);
+                    program_queue.push(second);
+                }
+                operation(program_queue, 0, error_handler);
+            }
+        }
+        else {
+            for (uint64_t i = 0; i < iterations; i++) {
+                program_queue.push(first);
+                program_queue.push(second);
+                operation(program_queue, 0, error_handler);
+                program_queue.pop();
+            }
+        }
+        double seconds = secondsSince(start);
+        if (run == 0 || seconds < best) best = seconds;
+    }
+    return {name, iterations, iterations, 0, best};
+}
+
+/**
+ * Writes a result as a JSON object. nsPerOp is per instruction executed, for an operation that is one call of it.
+ */
+static void writeResult(const Result& result, bool workload, bool last) {
+    printf("    {\"name\": \"%s\", \"size\": %llu, ", result.name.c_str(), static_cast<unsigned long long>(result.size));
+    if (workload) {
+        printf("\"instructions\": %llu, \"compileSeconds\": %.6f, \"seconds\": %.6f, \"instructionsPerSecond\": %.0f, ",
+               static_cast<unsigned long long>(result.instructions), result.compile_seconds, result.seconds, result.instructions / result.seconds);
+    }
+    else printf("\"seconds\": %.6f, ", result.seconds);
+    printf("\"nsPerOp\": %.3f}%s\n", result.seconds * 1e9 / result.instructions, last ? "" : ",");
+}
+
+int main(int argc, char* argv[]) {
+    double scale = 1;
+    int repeat = 5;
+    for (int arg = 1; arg < argc; arg++) {
+        string current_arg = argv[arg];
+        if (current_arg.rfind("--scale=", 0) == 0) scale = atof(current_arg.c_str() + 8);
+        else if (current_arg.rfind("--repeat=", 0) == 0) repeat = max(1, atoi(current_arg.c_str() + 9));
+        else {
+            fprintf(stderr, "usage: qu_bench [--scale=F] [--repeat=N]\n");
+            return 1;
+        }
+    }
+    auto scaled = [scale](uint64_t size) { return max<uint64_t>(1, static_cast<uint64_t>(size * scale)); };
+
+    vector<Workload> workloads = {
+        countingLoop(scaled(2000000)),
+        gotoLoop(scaled(2000000)),
+        stringAccumulation(scaled(200000)),
+        sortLargeQueue(scaled(500000)),
+        kOperations(scaled(500000)),
+        tagged(countingLoop(scaled(2000000))),
+        tagged(gotoLoop(scaled(2000000))),
+        tagged(kOperations(scaled(500000))),
+        readIngest(scaled(500000)),
+        jitted(countingLoop(scaled(2000000))),
+        jitted(gotoLoop(scaled(2000000))),
+        jitted(kOperations(scaled(500000))),
+    };
+    vector<Result> workload_results;
+    for (const Workload& workload : workloads) workload_results.push_back(runWorkload(workload, repeat));
+
+    uint64_t iterations = scaled(2000000);
+    node a(int64_t(1234567)), b(int64_t(89));
+    node text("a string of some length"), more("more");
+    vector<Result> operation_results = {
+        benchmarkOperation("quAdd", OperationHandler::quAdd, false, a, b, iterations, repeat),
+        benchmarkOperation("quAdd_strings", OperationHandler::quAdd, false, text, more, iterations, repeat),
+        benchmarkOperation("quAddK", OperationHandler::quAddK, true, a, b, iterations, repeat),
+        benchmarkOperation("quSub", OperationHandler::quSub, false, a, b, iterations, repeat),
+        benchmarkOperation("quSubK", OperationHandler::quSubK, true, a, b, iterations, repeat),
+        benchmarkOperation("quMul", OperationHandler::quMul, false, a, b, iterations, repeat),
+        benchmarkOperation("quMulK", OperationHandler::quMulK, true, a, b, iterations, repeat),
+        benchmarkOperation("quDiv", OperationHandler::quDiv, false, a, b, iterations, repeat),
+        benchmarkOperation("quDivK", OperationHandler::quDivK, true, a, b, iterations, repeat),
+        benchmarkOperation("quMod", OperationHandler::quMod, false, a, b, iterations, repeat),
+        benchmarkOperation("quModK", OperationHandler::quModK, true, a, b, iterations, repeat),
+    };
+
+    printf("{\n  \"repeat\": %d,\n  \"scale\": %g,\n  \"workloads\": [\n", repeat, scale);
+    for (size_t i = 0; i < workload_results.size(); i++) writeResult(workload_results[i], true, i + 1 == workload_results.size());
+    printf("  ],\n  \"operations\": [\n");
+    for (size_t i = 0; i < operation_results.size(); i++) writeResult(operation_results[i], false, i + 1 == operation_results.size());
+    printf("  ]\n}\n");
+    return 0;
+}
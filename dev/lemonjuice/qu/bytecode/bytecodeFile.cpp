@@ -0,0 +1,196 @@
+#include "bytecodeFile.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include "../output/queueWriter.h"
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+static const char MAGIC[4] = {'Q', 'U', 'C', '\0'};
+static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+struct BytecodeHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t byte_order; // BYTE_ORDER_MARK as the writer stored it.
+    uint32_t line_count;
+    uint32_t optimization_level;
+    uint32_t unused;
+    uint64_t source_hash;
+    uint64_t instruction_count;
+    uint64_t string_count;
+};
+
+struct InstructionRecord {
+    uint8_t opcode;
+    uint8_t unused[3];
+    int32_t line;
+    int64_t int_operand;
+};
+
+static_assert(sizeof(InstructionRecord) == 16, "Instruction records are 16 bytes in the file.");
+
+/**
+ * Hashes the text of a program with 64 bit FNV-1a, to key the cache on.
+ *
+ * @param text The text of the program.
+ * @return The hash.
+ */
+uint64_t BytecodeFile::hashSource(string_view text) {
+    uint64_t hash = 0xCBF29CE484222325;
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 0x100000001B3;
+    }
+    return hash;
+}
+
+/**
+ * Works out where the cached compiled form of a program goes: $QU_CACHE_DIR, or a "qu" directory in the user's cache directory.
+ *
+ * @param source_hash The hash of the program's text.
+ * @param optimization_level The level the program is optimized at, each level is cached separately.
+ * @return The path of the cache file, or an empty string if there is nowhere to cache to.
+ */
+string BytecodeFile::cachePath(uint64_t source_hash, int optimization_level) {
+    filesystem::path directory;
+    if (const char* dir = getenv("QU_CACHE_DIR")) directory = dir;
+    else if (const char* dir = getenv("XDG_CACHE_HOME")) directory = filesystem::path(dir) / "qu";
+    else if (const char* dir = getenv("LOCALAPPDATA")) directory = filesystem::path(dir) / "qu";
+    else if (const char* dir = getenv("HOME")) directory = filesystem::path(dir) / ".cache" / "qu";
+    else return "";
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx-O%d.quc", static_cast<unsigned long long>(source_hash), optimization_level);
+    return (directory / name).string();
+}
+
+/**
+ * Writes a compiled program to a file.
+ * The file is written under a temporary name and renamed into place, so a reader never sees half of one.
+ *
+ * @param program The compiled program.
+ * @param source_hash The hash of the program's text.
+ * @param path Where to write the file.
+ * @return true if the file was written, false otherwise.
+ */
+bool BytecodeFile::save(const Program& program, uint64_t source_hash, const string& path) {
+    error_code error;
+    filesystem::path target(path);
+    if (target.has_parent_path()) filesystem::create_directories(target.parent_path(), error);
+
+    // Unique to this process and this save, so processes and threads sharing the cache never write the same temporary file.
+    // "x" refuses to open a file that is already there, should one be left over from a process that had the same id.
+    static atomic<unsigned> saves(0);
+    string temporary = path + ".tmp" + to_string(getpid()) + "-" + to_string(saves++);
+    FILE* file = fopen(temporary.c_str(), "wbx");
+    if (file == nullptr) return false;
+
+    BytecodeHeader header = {};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = FORMAT_VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.line_count = static_cast<uint32_t>(program.line_count);
+    header.optimization_level = static_cast<uint32_t>(program.optimization_level);
+    header.source_hash = source_hash;
+    header.instruction_count = program.code.size();
+    header.string_count = program.strings.size();
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+
+    for (const Instruction& instruction : program.code) {
+        InstructionRecord record = {};
+        record.opcode = static_cast<uint8_t>(instruction.opcode);
+        record.line = instruction.line;
+        record.int_operand = instruction.int_operand;
+        written = written && fwrite(&record, sizeof(record), 1, file) == 1;
+    }
+    for (const string& text : program.strings) {
+        uint64_t length = text.size();
+        written = written && fwrite(&length, sizeof(length), 1, file) == 1;
+        written = written && fwrite(text.data(), 1, text.size(), file) == text.size();
+    }
+
+    written = fclose(file) == 0 && written;
+    if (written) filesystem::rename(temporary, target, error);
+    if (!written || error) {
+        filesystem::remove(temporary, error);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Reads a compiled program, checking that every instruction is one this interpreter can run.
+ *
+ * @param contents The contents of a .quc file.
+ * @param program Receives the program.
+ * @param source_hash Receives the hash of the text the program was compiled from.
+ * @return true if the contents are a valid compiled program, false otherwise.
+ */
+bool BytecodeFile::load(string_view contents, Program& program, uint64_t& source_hash) {
+    BytecodeHeader header;
+    if (contents.size() < sizeof(header)) return false;
+    memcpy(&header, contents.data(), sizeof(header));
+    contents.remove_prefix(sizeof(header));
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != FORMAT_VERSION || header.byte_order != BYTE_ORDER_MARK) return false;
+    if (header.instruction_count == 0 || header.instruction_count > contents.size() / sizeof(InstructionRecord)) return false;
+
+    Program loaded;
+    loaded.line_count = static_cast<int>(header.line_count);
+    loaded.optimization_level = static_cast<int>(header.optimization_level);
+    loaded.code.resize(header.instruction_count);
+    for (Instruction& instruction : loaded.code) {
+        InstructionRecord record;
+        memcpy(&record, contents.data(), sizeof(record));
+        contents.remove_prefix(sizeof(record));
+        if (record.opcode > static_cast<uint8_t>(Opcode::Halt)) return false;
+        instruction = {static_cast<Opcode>(record.opcode), record.line, record.int_operand, nullptr};
+    }
+
+    for (uint64_t i = 0; i < header.string_count; i++) {
+        uint64_t length;
+        if (contents.size() < sizeof(length)) return false;
+        memcpy(&length, contents.data(), sizeof(length));
+        contents.remove_prefix(sizeof(length));
+        if (length > contents.size()) return false;
+        loaded.strings.emplace_back(contents.substr(0, length));
+        contents.remove_prefix(length);
+    }
+
+    // Operands that index something must stay inside it, and the code must end where the executor expects it to.
+    if (loaded.code.back().opcode != Opcode::Halt) return false;
+    for (size_t i = 0; i < loaded.code.size(); i++) {
+        const Instruction& instruction = loaded.code[i];
+        switch (instruction.opcode) {
+            case Opcode::IfEqGoto: case Opcode::IfGtGoto: case Opcode::IfLtGoto: case Opcode::IfNqGoto:
+                // A fused IF* takes the target of the GOTO after it.
+                if (loaded.code[i + 1].opcode != Opcode::Goto) return false;
+                [[fallthrough]];
+            case Opcode::Goto: case Opcode::IfEq: case Opcode::IfGt: case Opcode::IfLt: case Opcode::IfNq:
+                if (instruction.int_operand < 0 || static_cast<uint64_t>(instruction.int_operand) >= loaded.code.size()) return false;
+                break;
+            case Opcode::Print: case Opcode::PushString: case Opcode::Read: case Opcode::ReadAll:
+                if (instruction.int_operand < 0 || static_cast<uint64_t>(instruction.int_operand) >= loaded.strings.size()) return false;
+                break;
+            case Opcode::QDisplay:
+                if (instruction.int_operand != static_cast<int64_t>(DisplayFormat::List) && instruction.int_operand != static_cast<int64_t>(DisplayFormat::Json)) return false;
+                break;
+            default:
+                break;
+        }
+    }
+
+    program = std::move(loaded);
+    source_hash = header.source_hash;
+    return true;
+}
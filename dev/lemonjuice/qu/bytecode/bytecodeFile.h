@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "../compiler/instruction.h"
+
+/**
+ * Reads and writes compiled programs (.quc files), so a program that hasn't changed doesn't have to be compiled again.
+ *
+ * A .quc file is a header, then one 16 byte record per instruction, then the string pool as a length followed by the
+ * characters of each string. Everything is stored in the byte order of the machine that wrote it, which the header
+ * records, and a file from another machine or another version of the format is simply refused.
+ */
+class BytecodeFile {
+private:
+    // Bump this whenever the format or the meaning of any instruction changes, so stale files are recompiled.
+    static constexpr uint32_t FORMAT_VERSION = 2;
+public:
+    static uint64_t hashSource(std::string_view text);
+    static std::string cachePath(uint64_t source_hash, int optimization_level);
+    static bool save(const Program& program, uint64_t source_hash, const std::string& path);
+    static bool load(std::string_view contents, Program& program, uint64_t& source_hash);
+};
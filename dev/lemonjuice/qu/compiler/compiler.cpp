@@ -0,0 +1,308 @@
+#include "compiler.h"
+
+#include <charconv>
+#include <map>
+#include <string_view>
+#include "../output/queueWriter.h"
+
+using namespace std;
+
+// Table of every mnemonic and the opcode it decodes to.
+struct Mnemonic {
+    const char* name;
+    Opcode opcode;
+};
+
+static const Mnemonic MNEMONICS[] = {
+    {"ADD", Opcode::Add},           {"ADDK", Opcode::AddK},
+    {"DIV", Opcode::Div},           {"DIVK", Opcode::DivK},
+    {"EMPTY", Opcode::Empty},
+    {"GOTO", Opcode::Goto},
+    {"IFEQ", Opcode::IfEq},         {"IFGT", Opcode::IfGt},
+    {"IFLT", Opcode::IfLt},         {"IFNQ", Opcode::IfNq},
+    {"MOD", Opcode::Mod},           {"MODK", Opcode::ModK},
+    {"MUL", Opcode::Mul},           {"MULK", Opcode::MulK},
+    {"PEEK", Opcode::Peek},         {"PEEKLN", Opcode::PeekLn},
+    {"POKE", Opcode::Poke},
+    {"POP", Opcode::Pop},           {"POPLN", Opcode::PopLn},
+    {"POPALL", Opcode::PopAll},     {"POPALLLN", Opcode::PopAllLn},
+    {"PRINT", Opcode::Print},
+    {"PUSH", Opcode::PushInt},
+    {"QDISPLAY", Opcode::QDisplay},
+    {"READ", Opcode::Read},         {"READALL", Opcode::ReadAll},
+    {"RET", Opcode::Ret},
+    {"SORTDOWN", Opcode::SortDown}, {"SORTUP", Opcode::SortUp},
+    {"SUB", Opcode::Sub},           {"SUBK", Opcode::SubK},
+};
+
+/**
+ * Removes leading and trailing whitespace (including a Windows '\r') from a piece of text.
+ *
+ * @param text The text to trim.
+ * @return The trimmed text.
+ */
+static string_view trim(string_view text) {
+    size_t first = text.find_first_not_of(" \t\r");
+    if (first == string_view::npos) return string_view();
+    size_t last = text.find_last_not_of(" \t\r");
+    return text.substr(first, last - first + 1);
+}
+
+/**
+ * Removes a single pair of surrounding double quotes from a piece of text, if both exist.
+ *
+ * @param text The text to unquote.
+ * @return The text without its surrounding quotes.
+ */
+static string_view unquote(string_view text) {
+    if (text.size() >= 2 && text.front() == '"' && text.back() == '"') return text.substr(1, text.size() - 2);
+    return text;
+}
+
+/**
+ * Parses a whole piece of text as an integer, without throwing.
+ *
+ * @param text The text to parse.
+ * @param value Receives the integer on success.
+ * @return true if the entire text is an integer, false otherwise.
+ */
+static bool parseInteger(string_view text, int64_t& value) {
+    if (!text.empty() && text.front() == '+') text.remove_prefix(1);
+    if (text.empty()) return false;
+    auto result = from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == errc() && result.ptr == text.data() + text.size();
+}
+
+/**
+ * Adds a string to the program's string pool.
+ *
+ * @param program The program being built.
+ * @param text The string to add.
+ * @return The index of the string in the pool.
+ */
+static int addString(Program& program, string_view text) {
+    program.strings.emplace_back(text);
+    return static_cast<int>(program.strings.size() - 1);
+}
+
+/**
+ * Decodes the operand of a PUSH instruction, which is either a quoted string or an integer.
+ *
+ * @param instruction The instruction being decoded.
+ * @param operand The text after the mnemonic.
+ * @param program The program being built.
+ * @param error_handler The interpreter's error handler.
+ */
+static void decodePush(Instruction& instruction, string_view operand, Program& program, errorHandler& error_handler) {
+    size_t quote_pos1 = operand.find('"'); // The first occurrence of '\"'
+    size_t quote_pos2 = operand.rfind('"'); // The last occurrence of '\"'
+
+    if (quote_pos1 != string_view::npos) {
+        // If quotes are found, it's a string
+        if (quote_pos1 == quote_pos2) {
+            error_handler.invalidPush(instruction.line);
+            return;
+        }
+        string push_string(operand.substr(quote_pos1 + 1, quote_pos2 - quote_pos1 - 1));
+
+        // Replace escape sequences with their corresponding characters
+        for (size_t pos = push_string.find('\\'); pos != string::npos; pos = push_string.find('\\', pos + 1)) {
+            if (pos + 1 < push_string.size() && push_string[pos + 1] == 'n') push_string.replace(pos, 2, "\n");
+        }
+
+        instruction.opcode = Opcode::PushString;
+        instruction.int_operand = addString(program, push_string);
+    } else {
+        // If quotes are not found, treat it as an integer
+        if (!parseInteger(operand, instruction.int_operand)) error_handler.invalidPush(instruction.line);
+        instruction.opcode = Opcode::PushInt;
+    }
+}
+
+/**
+ * Reads the name of a saved position from a saved position line, "|name|".
+ *
+ * @param current_line The trimmed line, starting with '|'.
+ * @param line The line index, for error handling.
+ * @param error_handler The interpreter's error handler.
+ * @return The name between the bars.
+ */
+static string_view labelName(string_view current_line, int line, errorHandler& error_handler) {
+    size_t bar_pos2 = current_line.rfind('|'); // The last occurrence of '|'
+    if (bar_pos2 == 0) error_handler.singleBarError(0, line);
+    return trim(current_line.substr(1, bar_pos2 - 1));
+}
+
+/**
+ * Rewrites every GOTO and IF* instruction so its operand is the index of the instruction it jumps to.
+ * Execution resumes at the first instruction after the line that is named, either by number or by saved position.
+ * Every target is checked here, so a jump at run time never fails.
+ *
+ * @param program The program being built, with each jump holding its line number.
+ * @param saved_positions The line of every saved position.
+ * @param jump_labels The saved position named by each jump that used one, keyed by instruction index.
+ * @param error_handler The interpreter's error handler.
+ */
+static void link(Program& program, const map<string, int, less<>>& saved_positions, const map<size_t, string>& jump_labels, errorHandler& error_handler) {
+    // Record where execution resumes after every line, the last line resumes at the Halt.
+    vector<int> resume_index(program.line_count);
+    int next = static_cast<int>(program.code.size()) - 1;
+    for (int line = program.line_count - 1; line >= 0; line--) {
+        resume_index[line] = next;
+        if (next > 0 && program.code[next - 1].line == line) next--;
+    }
+
+    for (size_t index = 0; index < program.code.size(); index++) {
+        Instruction& instruction = program.code[index];
+        if (!Compiler::isJump(instruction.opcode)) continue;
+
+        int64_t line_number = instruction.int_operand;
+        auto label = jump_labels.find(index);
+        if (label != jump_labels.end()) {
+            auto position = saved_positions.find(label->second);
+            if (position == saved_positions.end()) {
+                // Error: Invalid saved position
+                if (instruction.opcode == Opcode::Goto) error_handler.invalidGoto(instruction.line);
+                else error_handler.unknownInstruction(instruction.line);
+                return;
+            }
+            line_number = position->second;
+        }
+
+        // Check if the line number is valid
+        if (line_number < 0 || line_number >= program.line_count) {
+            error_handler.invalidGoto(instruction.line);
+            return;
+        }
+        instruction.int_operand = resume_index[line_number];
+    }
+}
+
+/**
+ * Decodes the text of a program into instructions, once, before it is run.
+ * Blank lines and saved position lines ("|name|") produce no instructions.
+ *
+ * @param program_text The lines of the program.
+ * @param error_handler The interpreter's error handler, which must not hold an error yet.
+ * @return The decoded and linked program, or an empty program (with no Halt) if an error was reported.
+ */
+Program Compiler::compile(const vector<string_view>& program_text, errorHandler& error_handler) {
+    Program program;
+    program.line_count = static_cast<int>(program_text.size());
+    map<string, int, less<>> saved_positions; // The line of every saved position.
+    map<size_t, string> jump_labels; // The saved position named by each jump, keyed by instruction index.
+
+    for (int i = 0; i < program.line_count; i++) {
+        string_view current_line = trim(program_text[i]);
+
+        // Skip empty lines
+        if (current_line.empty()) continue;
+
+        // Lines starting with '|' only save their position
+        if (current_line.front() == '|') {
+            saved_positions.emplace(labelName(current_line, i, error_handler), i);
+            if (error_handler.failed()) return Program();
+            continue;
+        }
+
+        // Split the line into its mnemonic and its operand
+        size_t split = current_line.find_first_of(" \t");
+        string_view name = current_line.substr(0, split);
+        string_view operand = split == string_view::npos ? string_view() : trim(current_line.substr(split));
+
+        const Mnemonic* mnemonic = nullptr;
+        for (const Mnemonic& candidate : MNEMONICS) {
+            if (name == candidate.name) {
+                mnemonic = &candidate;
+                break;
+            }
+        }
+        if (mnemonic == nullptr) {
+            error_handler.unknownInstruction(i);
+            return Program();
+        }
+
+        Instruction instruction = {mnemonic->opcode, i, 0, nullptr};
+        switch (instruction.opcode) {
+            case Opcode::PushInt:
+                decodePush(instruction, operand, program, error_handler);
+                break;
+            case Opcode::QDisplay:
+                // QDISPLAY lists the queue unless it is asked for JSON
+                if (operand == "JSON") instruction.int_operand = static_cast<int64_t>(DisplayFormat::Json);
+                else if (operand.empty()) instruction.int_operand = static_cast<int64_t>(DisplayFormat::List);
+                else error_handler.unknownInstruction(i);
+                break;
+            case Opcode::Print:
+            case Opcode::Read:
+            case Opcode::ReadAll:
+                instruction.int_operand = addString(program, unquote(operand));
+                break;
+            case Opcode::Goto:
+            case Opcode::IfEq:
+            case Opcode::IfGt:
+            case Opcode::IfLt:
+            case Opcode::IfNq:
+                // The operand is either a line number or a saved position, written with or without its bars
+                if (!parseInteger(operand, instruction.int_operand)) {
+                    if (operand.size() >= 2 && operand.front() == '|' && operand.back() == '|') operand = trim(operand.substr(1, operand.size() - 2));
+                    jump_labels.emplace(program.code.size(), operand);
+                }
+                break;
+            default:
+                break;
+        }
+        if (error_handler.failed()) return Program();
+        program.code.push_back(instruction);
+    }
+
+    // Running off the end of the program stops it.
+    program.code.push_back({Opcode::Halt, program.line_count, 0, nullptr});
+
+    link(program, saved_positions, jump_labels, error_handler);
+    if (error_handler.failed()) return Program();
+    return program;
+}
+
+/**
+ * Checks if an opcode is GOTO or one of the IF* instructions.
+ *
+ * @param opcode The opcode.
+ * @return true if the opcode's operand is a jump target.
+ */
+bool Compiler::isJump(Opcode opcode) {
+    switch (opcode) {
+        case Opcode::Goto:
+        case Opcode::IfEq: case Opcode::IfGt: case Opcode::IfLt: case Opcode::IfNq:
+        case Opcode::IfEqGoto: case Opcode::IfGtGoto: case Opcode::IfLtGoto: case Opcode::IfNqGoto:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * Gets the mnemonic of an opcode.
+ *
+ * @param opcode The opcode.
+ * @return The mnemonic as written in a program, superinstructions are named after the instructions they replace.
+ */
+const char* Compiler::opcodeName(Opcode opcode) {
+    switch (opcode) {
+        case Opcode::PushString: return "PUSH";
+        case Opcode::PushAdd: return "PUSH+ADD";
+        case Opcode::PushSub: return "PUSH+SUB";
+        case Opcode::PushMul: return "PUSH+MUL";
+        case Opcode::PushDiv: return "PUSH+DIV";
+        case Opcode::PushMod: return "PUSH+MOD";
+        case Opcode::IfEqGoto: return "IFEQ+GOTO";
+        case Opcode::IfGtGoto: return "IFGT+GOTO";
+        case Opcode::IfLtGoto: return "IFLT+GOTO";
+        case Opcode::IfNqGoto: return "IFNQ+GOTO";
+        default: break;
+    }
+    for (const Mnemonic& mnemonic : MNEMONICS) {
+        if (mnemonic.opcode == opcode) return mnemonic.name;
+    }
+    return "?";
+}
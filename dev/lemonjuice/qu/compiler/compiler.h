@@ -0,0 +1,14 @@
+#pragma once
+
+#include "../error/errorHandler.h"
+#include "instruction.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+class Compiler {
+public:
+    static Program compile(const std::vector<std::string_view>& program_text, errorHandler& error_handler);
+    static const char* opcodeName(Opcode opcode);
+    static bool isJump(Opcode opcode);
+};
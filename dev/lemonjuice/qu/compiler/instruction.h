@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Every instruction the interpreter understands.
+ * PUSH is split by operand type so the execution loop never has to look at the operand to know what to do.
+ */
+enum class Opcode : unsigned char {
+    Add, AddK,
+    Div, DivK,
+    Empty,
+    Goto,
+    IfEq, IfGt, IfLt, IfNq,
+    Mod, ModK,
+    Mul, MulK,
+    Peek, PeekLn,
+    Poke,
+    Pop, PopLn, PopAll, PopAllLn,
+    Print,
+    PushInt, PushString,
+    QDisplay,
+    Read, ReadAll,
+    Ret,
+    SortDown, SortUp,
+    Sub, SubK,
+    // Superinstructions, only made by the optimizer.
+    PushAdd, PushSub, PushMul, PushDiv, PushMod, // PUSH followed by an operation, the line is the operation's.
+    IfEqGoto, IfGtGoto, IfLtGoto, IfNqGoto,      // IF* followed by GOTO, the GOTO stays in place and is jumped to when the IF* fails.
+    Halt // Never written in a program, marks the end of the decoded code.
+};
+
+/**
+ * A single decoded line of a program.
+ * Strings (PUSH/PRINT/READ text) live in the owning Program's string pool, the instruction only holds an index.
+ */
+struct Instruction {
+    Opcode opcode;
+    int line;            // The source line index, used for error messages.
+    int64_t int_operand; // PUSH value, jump target instruction index or string pool index.
+    const void* handler; // Address of the threaded dispatch handler, bound by Executor::bindHandlers.
+};
+
+/**
+ * A whole decoded program.
+ */
+struct Program {
+    std::vector<Instruction> code;    // The decoded instructions, in source order, ending with a Halt.
+    std::vector<std::string> strings; // String pool referenced by the instructions.
+    int line_count = 0;               // The number of lines in the program text.
+    int optimization_level = 0;       // The level the Optimizer ran at, 0 if it didn't.
+    bool integer_only = false;        // Proved by TypeInference when the program is prepared to run.
+};
@@ -3,6 +3,8 @@
 #include <iostream>
 #include <stdlib.h>
 #include <string>
+#include <utility>
+#include "../output/outputSink.h"
 
 using namespace std;
 
@@ -10,7 +12,12 @@ using namespace std;
 const std::string RED_COLOR = "\033[1;31m";
 const std::string RESET_COLOR = "\033[0m";
 
-errorHandler::errorHandler(){}
+/**
+ * Creates an error handler.
+ * 
+ * @param policy What happens when an error is reported.
+ */
+errorHandler::errorHandler(ErrorPolicy policy) : policy(policy) {}
 
 /**
  * Helper function to print error messages with red color
@@ -21,14 +28,85 @@ void errorHandler::printError(const string& error_message) {
     cerr << RED_COLOR << "Error: " << error_message << RESET_COLOR << endl;
 }
 
+/**
+ * Reports an error according to the policy: printed before the process ends, or kept for the caller to pick up.
+ * Only the first error is kept, anything after it is a consequence of it.
+ * 
+ * @param error_code What went wrong.
+ * @param error_message The message describing it.
+ */
+void errorHandler::fail(ErrorCode error_code, string error_message) {
+    if (policy == ErrorPolicy::Exit) {
+        if (output != nullptr) output->drain(); // What the program printed comes before the error that stopped it.
+        printError(error_message);
+        exitProgram(-1);
+    }
+    if (code != ErrorCode::None) return;
+    code = error_code;
+    message = std::move(error_message);
+}
+
+void errorHandler::setPolicy(ErrorPolicy policy) {
+    this->policy = policy;
+}
+
+ErrorPolicy errorHandler::getPolicy() const {
+    return policy;
+}
+
+/**
+ * Sets the output the program's buffered output is in, which the Exit policy writes out before it prints an error.
+ * Without it, the output would only be written when the process ends, after the error.
+ *
+ * @param output The output, or null for none.
+ */
+void errorHandler::setOutput(OutputSink* output) {
+    this->output = output;
+}
+
+/**
+ * @return true if an error has been reported since the handler was created or last cleared.
+ */
+bool errorHandler::failed() const {
+    return code != ErrorCode::None;
+}
+
+/**
+ * @return What went wrong, ErrorCode::None if nothing did.
+ */
+ErrorCode errorHandler::getCode() const {
+    return code;
+}
+
+/**
+ * @return The message of the error, empty if there wasn't one.
+ */
+const string& errorHandler::getMessage() const {
+    return message;
+}
+
+/**
+ * Forgets the error, so the handler can be used again.
+ */
+void errorHandler::clear() {
+    code = ErrorCode::None;
+    message.clear();
+}
+
+/**
+ * Prints the error that was kept, the same way the Exit policy would have.
+ */
+void errorHandler::report() const {
+    if (code != ErrorCode::None) printError(message);
+}
+
 /**
  * Handles errors when an error occurs when a division by zero happens.
  * 
  * @param line The line of the error.
  */
 void errorHandler::divisionByZero(int line){
-    printError("Division by zero error at line: " + to_string(line));
-    exitProgram(-1);
+    fail(ErrorCode::DivisionByZero, "Division by zero error at line: " + to_string(line));
 }
 
 /**
@@ -46,8 +124,7 @@ void errorHandler::exitProgram(int exitCode){
  * @param line The line of the error.
  */
 void errorHandler::invalidPush(int line){
-    printError("Invalid PUSH operation at line: " + to_string(line));
-    exitProgram(-1);
+    fail(ErrorCode::InvalidPush, "Invalid PUSH operation at line: " + to_string(line));
 }
 
 /**
@@ -57,15 +134,14 @@ void errorHandler::invalidPush(int line){
  * @param expected_args The expected number of args that should have been specified.
  */
 void errorHandler::extraFileArguments(int max_arg, int expected_args){
-    cerr << RED_COLOR << "Error: Extra file argument(s) at index (indices): ";
-    for (size_t i = expected_args; i <= max_arg; i++) {
-        cerr << i;
+    string message = "Extra file argument(s) at index (indices): ";
+    for (int i = expected_args; i <= max_arg; i++) {
+        message += to_string(i);
         if (i + 1 <= max_arg) {
-            cerr << ", ";
+            message += ", ";
         }
     }
-    cerr << "." << RESET_COLOR << endl;
-    exitProgram(-1);
+    fail(ErrorCode::ExtraFileArguments, message + ".");
 }
 
 /**
@@ -74,8 +150,7 @@ void errorHandler::extraFileArguments(int max_arg, int expected_args){
  * @param file_name The file's name.
  */
 void errorHandler::invalidFileExtension(std::string file_name){
-    printError("Invalid file extension for file: " + file_name + ". File name must end with \".qu\".");
-    exitProgram(-1);
+    fail(ErrorCode::InvalidFileExtension, "Invalid file extension for file: " + file_name + ". File name must end with \".qu\".");
 }
 
 /**
@@ -84,8 +159,43 @@ void errorHandler::invalidFileExtension(std::string file_name){
  * @param arg The index of the missing arg.
  */
 void errorHandler::missingFileArgument(int arg){
-    printError("Missing file argument at index: " + to_string(arg));
-    exitProgram(-1);
+    fail(ErrorCode::MissingFileArgument, "Missing file argument at index: " + to_string(arg));
+}
+
+/**
+ * Handles errors when an option the interpreter doesn't understand is passed at interpretation.
+ * 
+ * @param option The option as it was passed.
+ */
+void errorHandler::unknownOption(std::string option){
+    fail(ErrorCode::UnknownOption, "Unknown option: " + option);
+}
+
+/**
+ * Handles errors when a compiled program file can't be read, or was written by a different version of the interpreter.
+ * 
+ * @param file_name The name of the file.
+ */
+void errorHandler::invalidBytecodeFile(std::string file_name){
+    fail(ErrorCode::InvalidBytecodeFile, "Invalid compiled program file: " + file_name);
+}
+
+/**
+ * Handles errors when a compiled program can't be written out.
+ * 
+ * @param file_name The name of the file that couldn't be written.
+ */
+void errorHandler::bytecodeWriteFailed(std::string file_name){
+    fail(ErrorCode::BytecodeWriteFailed, "Could not write compiled program to: " + file_name);
+}
+
+/**
+ * Handles errors when the manifest passed to --batch can't be read.
+ * 
+ * @param file_name The name of the manifest.
+ */
+void errorHandler::invalidBatchManifest(std::string file_name){
+    fail(ErrorCode::InvalidBatchManifest, "Could not read batch manifest: " + file_name);
 }
 
 /**
@@ -94,8 +204,7 @@ void errorHandler::missingFileArgument(int arg){
  * @param line The line of the error.
  */
 void errorHandler::invalidGoto(int line){
-    printError("Invalid GOTO operation at line: " + to_string(line));
-    exitProgram(-1);
+    fail(ErrorCode::InvalidGoto, "Invalid GOTO operation at line: " + to_string(line));
 }
 
 /**
@@ -104,8 +213,7 @@ void errorHandler::invalidGoto(int line){
  * @param line The line of the error.
  */
 void errorHandler::nonIntegerReturnValue(int line){
-    printError("Invalid return value. Non-integer value returned at line: " + to_string(line));
-    exitProgram(-1);
+    fail(ErrorCode::NonIntegerReturnValue, "Invalid return value. Non-integer value returned at line: " + to_string(line));
 }
 
 /**
@@ -114,8 +222,7 @@ void errorHandler::nonIntegerReturnValue(int line){
  * @param line The line of the error.
  */
 void errorHandler::notEnoughArguments(int line){
-    printError("Missing arguments at line: " + to_string(line));
-    exitProgram(-1);
+    fail(ErrorCode::NotEnoughArguments, "Missing arguments at line: " + to_string(line));
 }
 
 /**
@@ -124,8 +231,7 @@ void errorHandler::notEnoughArguments(int line){
  * @param line The line of the error.
  */
 void errorHandler::unspecifiedComparisonOperation(int line){
-    printError("An unspecified comparsion operation was used at line: " + to_string(line));
-    exitProgram(-1);
+    fail(ErrorCode::UnspecifiedComparisonOperation, "An unspecified comparsion operation was used at line: " + to_string(line));
 }
 
 /**
@@ -134,8 +240,7 @@ void errorHandler::unspecifiedComparisonOperation(int line){
  * @param line The line of the error.
  */
 void errorHandler::returnFromEmptyQueue(int line){
-    printError("Attempted to return value from an empty queue at line: " + to_string(line));
-    exitProgram(-1);
+    fail(ErrorCode::ReturnFromEmptyQueue, "Attempted to return value from an empty queue at line: " + to_string(line));
 }
 
 /**
@@ -144,8 +249,7 @@ void errorHandler::returnFromEmptyQueue(int line){
  * @param line The line of the error.
  */
 void errorHandler::operationMismatch(int line){
-    printError("Incompatible operation between string and integer nodes at line: " + to_string(line));
-    exitProgram(-1);
+    fail(ErrorCode::OperationMismatch, "Incompatible operation between string and integer nodes at line: " + to_string(line));
 }
 
 /**
@@ -154,8 +258,7 @@ void errorHandler::operationMismatch(int line){
  * @param line The line of the error.
  */
 void errorHandler::invalidPrintOperation(int line){
-    printError("Invalid PRINT operation at line: " + to_string(line));
-    exitProgram(-1);
+    fail(ErrorCode::InvalidPrintOperation, "Invalid PRINT operation at line: " + to_string(line));
 }
 
 /**
@@ -164,8 +267,7 @@ void errorHandler::invalidPrintOperation(int line){
  * @param line The line of the error.
  */
 void errorHandler::invalidReadOperation(int line){
-    printError("Invalid READ operation at line: " + to_string(line));
-    exitProgram(-1);
+    fail(ErrorCode::InvalidReadOperation, "Invalid READ operation at line: " + to_string(line));
 }
 
 /**
@@ -175,8 +277,7 @@ void errorHandler::invalidReadOperation(int line){
  * @param line The line of the error.
  */
 void errorHandler::singleBarError(int index, int line){
-    printError("Single '|' character at line: " + to_string(line) + ", index: " + to_string(index));
-    exitProgram(-1);
+    fail(ErrorCode::SingleBar, "Single '|' character at line: " + to_string(line) + ", index: " + to_string(index));
 }
 
 /**
@@ -186,8 +287,7 @@ void errorHandler::singleBarError(int index, int line){
  * @param line The line of the error.
  */
 void errorHandler::singleQuoteError(int index, int line){
-    printError("Single '\"' character at line: " + to_string(line) + ", index: " + to_string(index));
-    exitProgram(-1);
+    fail(ErrorCode::SingleQuote, "Single '\"' character at line: " + to_string(line) + ", index: " + to_string(index));
 }
 
 /**
@@ -196,6 +296,5 @@ void errorHandler::singleQuoteError(int index, int line){
  * @param line The line of the error.
  */
 void errorHandler::unknownInstruction(int line){
-    printError("Unknown instruction at line: " + to_string(line));
-    exitProgram(-1);
+    fail(ErrorCode::UnknownInstruction, "Unknown instruction at line: " + to_string(line));
 }
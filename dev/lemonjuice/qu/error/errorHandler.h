@@ -1,41 +1,100 @@
-#pragma once 
+#pragma once
 #include <string>
 
+// Error reporting is kept out of line and out of the way of the code around it, which only pays for the check.
+#if defined(__GNUC__) || defined(__clang__)
+#define QU_COLD __attribute__((cold, noinline))
+#define QU_UNLIKELY(condition) __builtin_expect(!!(condition), 0)
+#else
+#define QU_COLD
+#define QU_UNLIKELY(condition) (condition)
+#endif
+
+class OutputSink;
+
+/**
+ * What happens when an error is reported.
+ */
+enum class ErrorPolicy {
+    Exit,  // Print the error and end the process, as the command line does for its own errors.
+    Return // Keep the error for the caller, whatever reported it gives up and returns.
+};
+
+/**
+ * Every error that can be reported, one per reporting method.
+ */
+enum class ErrorCode {
+    None,
+    DivisionByZero,
+    InvalidPush,
+    ExtraFileArguments, InvalidFileExtension, MissingFileArgument, UnknownOption,
+    InvalidBytecodeFile, BytecodeWriteFailed, InvalidBatchManifest,
+    InvalidGoto,
+    NonIntegerReturnValue,
+    NotEnoughArguments,
+    OperationMismatch,
+    UnspecifiedComparisonOperation,
+    InvalidPrintOperation,
+    InvalidReadOperation,
+    ReturnFromEmptyQueue,
+    SingleBar, SingleQuote,
+    UnknownInstruction
+};
+
 class errorHandler{
 private:
-    void printError(const std::string& message);
+    ErrorPolicy policy;
+    ErrorCode code = ErrorCode::None; // The first error reported, under the Return policy.
+    std::string message;
+    OutputSink* output = nullptr; // Written out before the Exit policy prints an error and ends the process.
+
+    static void printError(const std::string& message);
+    void fail(ErrorCode code, std::string message);
 public:
-    errorHandler();
+    explicit errorHandler(ErrorPolicy policy = ErrorPolicy::Exit);
+
+    void setPolicy(ErrorPolicy policy);
+    ErrorPolicy getPolicy() const;
+    void setOutput(OutputSink* output);
+    bool failed() const;
+    ErrorCode getCode() const;
+    const std::string& getMessage() const;
+    void clear();
+    void report() const;
 
-    void divisionByZero(int);
+    QU_COLD void divisionByZero(int);
 
-    void exitProgram(int);
+    QU_COLD void exitProgram(int);
 
-    void invalidPush(int);
+    QU_COLD void invalidPush(int);
 
-    void extraFileArguments(int, int);
-    void invalidFileExtension(std::string);
-    void missingFileArgument(int);
+    QU_COLD void extraFileArguments(int, int);
+    QU_COLD void invalidFileExtension(std::string);
+    QU_COLD void missingFileArgument(int);
+    QU_COLD void unknownOption(std::string);
+    QU_COLD void invalidBytecodeFile(std::string);
+    QU_COLD void bytecodeWriteFailed(std::string);
+    QU_COLD void invalidBatchManifest(std::string);
 
-    void invalidGoto(int);
+    QU_COLD void invalidGoto(int);
 
-    void nonIntegerReturnValue(int);
+    QU_COLD void nonIntegerReturnValue(int);
 
-    void notEnoughArguments(int);
+    QU_COLD void notEnoughArguments(int);
 
-    void operationMismatch(int);
+    QU_COLD void operationMismatch(int);
 
-    void unspecifiedComparisonOperation(int);
+    QU_COLD void unspecifiedComparisonOperation(int);
 
-    void invalidPrintOperation(int);
+    QU_COLD void invalidPrintOperation(int);
 
-    void invalidReadOperation(int);
+    QU_COLD void invalidReadOperation(int);
 
-    void returnFromEmptyQueue(int); 
+    QU_COLD void returnFromEmptyQueue(int);
 
-    void singleBarError(int, int);
-    void singleQuoteError(int, int);
+    QU_COLD void singleBarError(int, int);
+    QU_COLD void singleQuoteError(int, int);
 
-    void unknownInstruction(int);
+    QU_COLD void unknownInstruction(int);
 
-};
\ No newline at end of file
+};
@@ -0,0 +1,462 @@
+#include "executor.h"
+
+#include <memory>
+#include "intExecutor.h"
+#include "../jit/jitEngine.h"
+#include "../metrics/runtimeMetrics.h"
+#include "../operation/operationHandler.h"
+#include "../output/queueWriter.h"
+#include "../sort/sortEngine.h"
+
+using namespace std;
+
+/**
+ * The comparisons IF* instructions make between the first two elements of the queue.
+ */
+enum class Comparison { Equal, Greater, Less, NotEqual };
+
+/**
+ * Checks that the queue holds enough elements for an instruction, reporting an error if it doesn't.
+ *
+ * @param program_queue The queue of the program itself
+ * @param count The number of elements the instruction needs.
+ * @param line The line of the instruction, for error handling.
+ * @param error_handler The interpreter's error handler.
+ * @return true if there are enough elements.
+ */
+static inline bool enoughArguments(const RingQueue<node>& program_queue, size_t count, int line, errorHandler& error_handler) {
+    if (QU_UNLIKELY(program_queue.size() < count)) {
+        error_handler.notEnoughArguments(line);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Compares the first two elements of a queue, in place. The queue must hold at least two elements.
+ *
+ * @param program_queue The queue of the program itself
+ * @param comparison The type of comparison to check for
+ * @return the result of the comparison
+ */
+static inline bool compareFirstTwo(const RingQueue<node>& program_queue, Comparison comparison) {
+    int order = program_queue.peek(0).compare(program_queue.peek(1));
+    switch (comparison) {
+        case Comparison::Equal: return order == 0;
+        case Comparison::Greater: return order > 0;
+        case Comparison::Less: return order < 0;
+        case Comparison::NotEqual: return order != 0;
+    }
+    return false;
+}
+
+/**
+ * Pushes an integer for PUSH, tracing it when asked to.
+ *
+ * @param program_queue The queue of the program itself
+ * @param value The integer.
+ * @param output Where the trace goes.
+ * @param verbose Whether to trace the push.
+ */
+static inline void pushInt(RingQueue<node>& program_queue, int64_t value, OutputSink& output, bool verbose) {
+    if (verbose) {
+        output.write("Pushing integer: ");
+        output.writeInt(value);
+        output.endLine();
+    }
+    program_queue.push(node(value));
+}
+
+/**
+ * The execution loop, written once for both dispatch modes.
+ * Every handler is both a switch case and, when threaded dispatch is available, a label whose address is bound into the instructions.
+ * Handlers end by dispatching the next instruction themselves, so the threaded loop never returns to a central switch.
+ * The profiled build always uses the switch loop, and reports every instruction and taken jump to the profiler.
+ * The JIT build runs in either mode, offering every backward jump to the JIT and carrying on wherever the native code left off.
+ *
+ * @param program The decoded program.
+ * @param program_queue The queue for the program itself.
+ * @param error_handler The interpreter's error handler.
+ * @param input Where the program's input comes from.
+ * @param output Where the program's output goes.
+ * @param random Where POKE gets its random numbers.
+ * @param verbose Whether to trace what the program pushes.
+ * @param profiler Where the profiled build reports to, unused otherwise.
+ * @param jit Where the JIT build sends its backward jumps, unused otherwise.
+ * @param handler_table When not null, receives the table of handler addresses (indexed by opcode) instead of running anything.
+ * @return The value returned by RET, 0 if the program ran off its end, or -1 if it stopped on an error.
+ */
+template <bool Threaded, bool Profiled, bool Jitted>
+static int execute(const Program& program, RingQueue<node>& program_queue, errorHandler& error_handler, InputReader& input, OutputSink& output, RandomSource& random, bool verbose, Profiler* profiler, JitEngine* jit, const void* const** handler_table) {
+    static_assert(!(Threaded && Profiled), "The profiled build only uses the switch loop.");
+    static_assert(!(Profiled && Jitted), "The JIT build isn't profiled.");
+#if QU_THREADED_DISPATCH
+    // Indexed by opcode, so this must list the handlers in the same order as the Opcode enum.
+    static const void* const handlers[] = {
+        &&target_Add, &&target_AddK,
+        &&target_Div, &&target_DivK,
+        &&target_Empty,
+        &&target_Goto,
+        &&target_IfEq, &&target_IfGt, &&target_IfLt, &&target_IfNq,
+        &&target_Mod, &&target_ModK,
+        &&target_Mul, &&target_MulK,
+        &&target_Peek, &&target_PeekLn,
+        &&target_Poke,
+        &&target_Pop, &&target_PopLn, &&target_PopAll, &&target_PopAllLn,
+        &&target_Print,
+        &&target_PushInt, &&target_PushString,
+        &&target_QDisplay,
+        &&target_Read, &&target_ReadAll,
+        &&target_Ret,
+        &&target_SortDown, &&target_SortUp,
+        &&target_Sub, &&target_SubK,
+        &&target_PushAdd, &&target_PushSub, &&target_PushMul, &&target_PushDiv, &&target_PushMod,
+        &&target_IfEqGoto, &&target_IfGtGoto, &&target_IfLtGoto, &&target_IfNqGoto,
+        &&target_Halt,
+    };
+    static_assert(sizeof(handlers) / sizeof(handlers[0]) == static_cast<size_t>(Opcode::Halt) + 1, "Every opcode needs a handler.");
+    if (handler_table != nullptr) {
+        *handler_table = handlers;
+        return 0;
+    }
+#define TARGET(op) case Opcode::op: target_##op
+// The handlers bound into the instructions belong to the build without the JIT, so the JIT build looks each one up by opcode.
+#define DISPATCH() do { \
+        if (Threaded && Jitted) goto *handlers[static_cast<size_t>(ip->opcode)]; \
+        else if (Threaded) goto *ip->handler; \
+        else goto dispatch; \
+    } while (0)
+#else
+    (void) handler_table;
+#define TARGET(op) case Opcode::op
+#define DISPATCH() goto dispatch
+#endif
+// A computed goto skips destructors, so handlers must only dispatch once every object they created is out of scope.
+// Every loop goes through a jump, so that is where a report asked for by a signal is written.
+// An instruction that reported an error stops the program, the error itself is left in the error handler.
+#define CHECK(success) do { if (QU_UNLIKELY(!(success))) return -1; } while (0)
+#define NEXT() do { RuntimeMetrics::instructions_retired++; ip++; DISPATCH(); } while (0)
+#define JUMP_TO(target) do { \
+        RuntimeMetrics::instructions_retired++; \
+        RuntimeMetrics::poll(program_queue); \
+        ip = code + (target); \
+        DISPATCH(); \
+    } while (0)
+// A backward jump closes a loop, which the JIT may run natively and then send the interpreter on from wherever it stopped.
+#define JUMP() do { \
+        if (Profiled) profiler->taken(ip - code); \
+        size_t jit_resume = 0; \
+        if (Jitted && ip->int_operand <= ip - code && jit->backEdge(ip - code, program_queue, jit_resume)) JUMP_TO(jit_resume); \
+        JUMP_TO(ip->int_operand); \
+    } while (0)
+// When the IF* of a fused pair fails, its GOTO is profiled as though it ran, so the profile reads the same with or without -O1.
+// A backward GOTO is offered to the JIT as the GOTO itself would be.
+#define FUSED_GOTO() do { \
+        if (Profiled) { \
+            profiler->enter(ip + 1 - code); \
+            profiler->taken(ip + 1 - code); \
+        } \
+        size_t jit_resume = 0; \
+        if (Jitted && (ip + 1)->int_operand <= ip + 1 - code && jit->backEdge(ip + 1 - code, program_queue, jit_resume)) JUMP_TO(jit_resume); \
+        JUMP_TO((ip + 1)->int_operand); \
+    } while (0)
+
+    const Instruction* const code = program.code.data();
+    const Instruction* ip = code;
+    DISPATCH();
+
+dispatch:
+    if (Profiled) profiler->enter(ip - code);
+    switch (ip->opcode) {
+    TARGET(Add):
+        CHECK(OperationHandler::quAdd(program_queue, ip->line, error_handler));
+        NEXT();
+
+    TARGET(AddK):
+        CHECK(OperationHandler::quAddK(program_queue, ip->line, error_handler));
+        NEXT();
+
+    TARGET(Div):
+        CHECK(OperationHandler::quDiv(program_queue, ip->line, error_handler));
+        NEXT();
+
+    TARGET(DivK):
+        CHECK(OperationHandler::quDivK(program_queue, ip->line, error_handler));
+        NEXT();
+
+    TARGET(Empty):
+        (void) program_queue.empty(); // Ignoring the return value intentionally
+        NEXT();
+
+    TARGET(Goto):
+        JUMP();
+
+    TARGET(IfEq):
+        CHECK(enoughArguments(program_queue, 2, ip->line, error_handler));
+        if (compareFirstTwo(program_queue, Comparison::Equal)) JUMP();
+        NEXT();
+
+    TARGET(IfGt):
+        CHECK(enoughArguments(program_queue, 2, ip->line, error_handler));
+        if (compareFirstTwo(program_queue, Comparison::Greater)) JUMP();
+        NEXT();
+
+    TARGET(IfLt):
+        CHECK(enoughArguments(program_queue, 2, ip->line, error_handler));
+        if (compareFirstTwo(program_queue, Comparison::Less)) JUMP();
+        NEXT();
+
+    TARGET(IfNq):
+        CHECK(enoughArguments(program_queue, 2, ip->line, error_handler));
+        if (compareFirstTwo(program_queue, Comparison::NotEqual)) JUMP();
+        NEXT();
+
+    TARGET(Mod):
+        CHECK(OperationHandler::quMod(program_queue, ip->line, error_handler));
+        NEXT();
+
+    TARGET(ModK):
+        CHECK(OperationHandler::quModK(program_queue, ip->line, error_handler));
+        NEXT();
+
+    TARGET(Mul):
+        CHECK(OperationHandler::quMul(program_queue, ip->line, error_handler));
+        NEXT();
+
+    TARGET(MulK):
+        CHECK(OperationHandler::quMulK(program_queue, ip->line, error_handler));
+        NEXT();
+
+    TARGET(Peek):
+        CHECK(enoughArguments(program_queue, 1, ip->line, error_handler));
+        program_queue.front().p_print(output);
+        NEXT();
+
+    TARGET(PeekLn):
+        CHECK(enoughArguments(program_queue, 1, ip->line, error_handler));
+        program_queue.front().p_println(output);
+        NEXT();
+
+    TARGET(Poke):
+        random.shuffle(program_queue.linearize(), program_queue.size());
+        NEXT();
+
+    TARGET(Pop):
+        CHECK(enoughArguments(program_queue, 1, ip->line, error_handler));
+        program_queue.front().p_print(output);
+        program_queue.pop(); // This has to be done separately because ".pop()" doesn't return anything... why? Because who could ever want to see what the first element in a FIFO data structure was.
+        NEXT();
+
+    TARGET(PopLn):
+        CHECK(enoughArguments(program_queue, 1, ip->line, error_handler));
+        program_queue.front().p_println(output);
+        program_queue.pop();
+        NEXT();
+
+    TARGET(PopAll):
+        while (!program_queue.empty()) {
+            program_queue.front().p_print(output); // Print each popped element
+            program_queue.pop();
+        }
+        NEXT();
+
+    TARGET(PopAllLn):
+        while (!program_queue.empty()) {
+            program_queue.front().p_println(output); // Print each popped element on a new line
+            program_queue.pop();
+        }
+        NEXT();
+
+    TARGET(Print):
+        output.write(program.strings[ip->int_operand]);
+        output.endLine();
+        NEXT();
+
+    TARGET(PushInt):
+        pushInt(program_queue, ip->int_operand, output, verbose);
+        NEXT();
+
+    TARGET(PushString):
+        program_queue.push(node(program.strings[ip->int_operand]));
+        NEXT();
+
+    TARGET(QDisplay):
+        QueueWriter::write(output, program_queue, static_cast<DisplayFormat>(ip->int_operand));
+        output.endLine();
+        NEXT();
+
+    TARGET(Read): {
+        // Print the prompt
+        output.write(program.strings[ip->int_operand]);
+        output.endPrompt();
+
+        // Read a line from the user, the end of the input reads as an empty line
+        std::string_view line;
+        if (!input.readLine(line)) line = std::string_view();
+        program_queue.push(InputReader::toNode(line));
+    }
+        NEXT();
+
+    TARGET(ReadAll): {
+        // Print the prompt
+        output.write(program.strings[ip->int_operand]);
+        output.endPrompt();
+
+        // Push every line that is left
+        std::string_view line;
+        while (input.readLine(line)) program_queue.push(InputReader::toNode(line));
+    }
+        NEXT();
+
+    TARGET(Ret): {
+        // Check if the queue is empty
+        if (QU_UNLIKELY(program_queue.empty())) {
+            error_handler.returnFromEmptyQueue(ip->line);
+            return -1; // End the program with an error code
+        }
+        // Get the front of the queue
+        node front_node = program_queue.front();
+        program_queue.pop();
+        // Return the value of the front of the queue
+        if (QU_UNLIKELY(!front_node.containsInt())) {
+            error_handler.nonIntegerReturnValue(ip->line);
+            return -1;
+        }
+        RuntimeMetrics::instructions_retired++;
+        return static_cast<int>(front_node.getInt());
+    }
+
+    TARGET(SortDown):
+    TARGET(SortUp): {
+        // Sort the queue where it is, rather than through a copy of it.
+        bool ascending = ip->opcode == Opcode::SortUp;
+        SortEngine::sort(program_queue.linearize(), program_queue.size(), ascending);
+    }
+        NEXT();
+
+    TARGET(Sub):
+        CHECK(OperationHandler::quSub(program_queue, ip->line, error_handler));
+        NEXT();
+
+    TARGET(SubK):
+        CHECK(OperationHandler::quSubK(program_queue, ip->line, error_handler));
+        NEXT();
+
+    TARGET(PushAdd):
+        pushInt(program_queue, ip->int_operand, output, verbose);
+        CHECK(OperationHandler::quAdd(program_queue, ip->line, error_handler));
+        NEXT();
+
+    TARGET(PushSub):
+        pushInt(program_queue, ip->int_operand, output, verbose);
+        CHECK(OperationHandler::quSub(program_queue, ip->line, error_handler));
+        NEXT();
+
+    TARGET(PushMul):
+        pushInt(program_queue, ip->int_operand, output, verbose);
+        CHECK(OperationHandler::quMul(program_queue, ip->line, error_handler));
+        NEXT();
+
+    TARGET(PushDiv):
+        pushInt(program_queue, ip->int_operand, output, verbose);
+        CHECK(OperationHandler::quDiv(program_queue, ip->line, error_handler));
+        NEXT();
+
+    TARGET(PushMod):
+        pushInt(program_queue, ip->int_operand, output, verbose);
+        CHECK(OperationHandler::quMod(program_queue, ip->line, error_handler));
+        NEXT();
+
+    // The GOTO after a fused IF* is never run itself, the IF* jumps straight to its target instead.
+    TARGET(IfEqGoto):
+        CHECK(enoughArguments(program_queue, 2, ip->line, error_handler));
+        if (compareFirstTwo(program_queue, Comparison::Equal)) JUMP();
+        FUSED_GOTO();
+
+    TARGET(IfGtGoto):
+        CHECK(enoughArguments(program_queue, 2, ip->line, error_handler));
+        if (compareFirstTwo(program_queue, Comparison::Greater)) JUMP();
+        FUSED_GOTO();
+
+    TARGET(IfLtGoto):
+        CHECK(enoughArguments(program_queue, 2, ip->line, error_handler));
+        if (compareFirstTwo(program_queue, Comparison::Less)) JUMP();
+        FUSED_GOTO();
+
+    TARGET(IfNqGoto):
+        CHECK(enoughArguments(program_queue, 2, ip->line, error_handler));
+        if (compareFirstTwo(program_queue, Comparison::NotEqual)) JUMP();
+        FUSED_GOTO();
+
+    TARGET(Halt):
+        return 0;
+    }
+
+#undef TARGET
+#undef DISPATCH
+#undef CHECK
+#undef NEXT
+#undef JUMP_TO
+#undef JUMP
+#undef FUSED_GOTO
+    return 0;
+}
+
+/**
+ * Stores the threaded dispatch handler of every instruction in the instruction itself.
+ * This has to happen once before a program is run with threaded dispatch.
+ *
+ * @param program The decoded program.
+ */
+void Executor::bindHandlers(Program& program) {
+#if QU_THREADED_DISPATCH
+    const void* const* handlers = nullptr;
+    RingQueue<node> unused_queue;
+    errorHandler unused_handler;
+    InputReader unused_input(0);
+    OutputSink unused_output(stdout);
+    RandomSource unused_random(0);
+    execute<true, false, false>(program, unused_queue, unused_handler, unused_input, unused_output, unused_random, false, nullptr, nullptr, &handlers);
+    for (Instruction& instruction : program.code) instruction.handler = handlers[static_cast<int>(instruction.opcode)];
+#else
+    (void) program;
+#endif
+}
+
+/**
+ * Runs a decoded program.
+ *
+ * @param program The decoded program, with its handlers bound if threaded dispatch is used.
+ * @param program_queue The queue for the program itself.
+ * @param error_handler The interpreter's error handler.
+ * @param input Where the program's input comes from.
+ * @param output Where the program's output goes.
+ * @param random Where POKE gets its random numbers.
+ * @param mode How to dispatch instructions. Threaded dispatch falls back to the switch loop when it isn't available.
+ * @param verbose Whether to trace what the program pushes.
+ * @param profiler When not null, the program runs in the profiled build and this collects the profile.
+ * @param jit Whether to compile hot loops to native code. Ignored when profiling or tracing, or where there is no JIT.
+ * @return The value returned by RET, 0 if the program ran off its end, or -1 if it stopped on an error (which error_handler holds).
+ * A program proved to only ever hold integers runs on the IntExecutor, unless it is profiled. Either engine reports its loops to the JIT.
+ */
+int Executor::run(const Program& program, RingQueue<node>& program_queue, errorHandler& error_handler, InputReader& input, OutputSink& output, RandomSource& random, DispatchMode mode, bool verbose, Profiler* profiler, bool jit) {
+    if (profiler != nullptr) {
+        profiler->start(program);
+        int result = execute<false, true, false>(program, program_queue, error_handler, input, output, random, verbose, profiler, nullptr, nullptr);
+        profiler->stop();
+        return result;
+    }
+    // Native code doesn't trace its pushes, so --verbose keeps everything in the interpreter.
+    unique_ptr<JitEngine> engine;
+    if (jit && !verbose && JitEngine::available()) engine = make_unique<JitEngine>(program);
+    if (IntExecutor::accepts(program, program_queue)) return IntExecutor::run(program, program_queue, error_handler, output, random, mode, verbose, engine.get());
+
+    bool threaded = QU_THREADED_DISPATCH && mode == DispatchMode::Threaded;
+    if (engine != nullptr) {
+        return threaded
+            ? execute<true, false, true>(program, program_queue, error_handler, input, output, random, verbose, nullptr, engine.get(), nullptr)
+            : execute<false, false, true>(program, program_queue, error_handler, input, output, random, verbose, nullptr, engine.get(), nullptr);
+    }
+    if (threaded) return execute<true, false, false>(program, program_queue, error_handler, input, output, random, verbose, nullptr, nullptr, nullptr);
+    return execute<false, false, false>(program, program_queue, error_handler, input, output, random, verbose, nullptr, nullptr, nullptr);
+}
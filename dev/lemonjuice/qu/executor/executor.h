@@ -0,0 +1,31 @@
+#pragma once
+
+#include "../compiler/instruction.h"
+#include "../error/errorHandler.h"
+#include "../input/inputReader.h"
+#include "../node/node.h"
+#include "../output/outputSink.h"
+#include "../profile/profiler.h"
+#include "../queue/ringQueue.h"
+#include "../random/randomSource.h"
+
+// Direct-threaded dispatch needs the labels-as-values extension, everything else falls back to the switch loop.
+#if defined(__GNUC__) || defined(__clang__)
+#define QU_THREADED_DISPATCH 1
+#else
+#define QU_THREADED_DISPATCH 0
+#endif
+
+/**
+ * How the execution loop moves from one instruction to the next.
+ */
+enum class DispatchMode {
+    Switch,  // A switch on each instruction's opcode.
+    Threaded // A jump straight to each instruction's bound handler.
+};
+
+class Executor {
+public:
+    static void bindHandlers(Program& program);
+    static int run(const Program& program, RingQueue<node>& program_queue, errorHandler& error_handler, InputReader& input, OutputSink& output, RandomSource& random, DispatchMode mode, bool verbose, Profiler* profiler = nullptr, bool jit = false);
+};
@@ -0,0 +1,409 @@
+#include "intExecutor.h"
+
+#include "../jit/jitEngine.h"
+#include "../metrics/runtimeMetrics.h"
+#include "../output/queueWriter.h"
+#include "../sort/sortEngine.h"
+
+using namespace std;
+
+/**
+ * Checks that the queue holds enough elements for an instruction, reporting an error if it doesn't.
+ *
+ * @param program_queue The queue of the program itself
+ * @param count The number of elements the instruction needs.
+ * @param line The line of the instruction, for error handling.
+ * @param error_handler The interpreter's error handler.
+ * @return true if there are enough elements.
+ */
+static inline bool enoughArguments(const RingQueue<int64_t>& program_queue, size_t count, int line, errorHandler& error_handler) {
+    if (QU_UNLIKELY(program_queue.size() < count)) {
+        error_handler.notEnoughArguments(line);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Removes the first two elements of the queue, as ADD/SUB/MUL/DIV/MOD take their operands.
+ *
+ * @param program_queue The queue of the program itself, holding at least two elements.
+ * @param first Receives the front element.
+ * @param second Receives the element after it.
+ */
+static inline void popTwo(RingQueue<int64_t>& program_queue, int64_t& first, int64_t& second) {
+    first = program_queue.front();
+    program_queue.pop();
+    second = program_queue.front();
+    program_queue.pop();
+}
+
+/**
+ * Pushes an integer for PUSH, tracing it when asked to.
+ *
+ * @param program_queue The queue of the program itself
+ * @param value The integer.
+ * @param output Where the trace goes.
+ * @param verbose Whether to trace the push.
+ */
+static inline void pushInt(RingQueue<int64_t>& program_queue, int64_t value, OutputSink& output, bool verbose) {
+    if (verbose) {
+        output.write("Pushing integer: ");
+        output.writeInt(value);
+        output.endLine();
+    }
+    program_queue.push(value);
+}
+
+/**
+ * The execution loop on plain integers, written once for both dispatch modes like the loop in Executor.
+ * The handlers bound into the instructions belong to that loop, so threaded dispatch here looks each handler up by opcode.
+ *
+ * @param program The decoded program, which TypeInference has proved never makes a string.
+ * @param program_queue The queue for the program itself.
+ * @param error_handler The interpreter's error handler.
+ * @param output Where the program's output goes.
+ * @param random Where POKE gets its random numbers.
+ * @param verbose Whether to trace what the program pushes.
+ * @param jit Where the JIT build sends its backward jumps, unused otherwise.
+ * @return The value returned by RET, 0 if the program ran off its end, or -1 if it stopped on an error.
+ */
+template <bool Threaded, bool Jitted>
+static int execute(const Program& program, RingQueue<int64_t>& program_queue, errorHandler& error_handler, OutputSink& output, RandomSource& random, bool verbose, JitEngine* jit) {
+#if QU_THREADED_DISPATCH
+    // Indexed by opcode, so this must list the handlers in the same order as the Opcode enum.
+    static const void* const handlers[] = {
+        &&target_Add, &&target_AddK,
+        &&target_Div, &&target_DivK,
+        &&target_Empty,
+        &&target_Goto,
+        &&target_IfEq, &&target_IfGt, &&target_IfLt, &&target_IfNq,
+        &&target_Mod, &&target_ModK,
+        &&target_Mul, &&target_MulK,
+        &&target_Peek, &&target_PeekLn,
+        &&target_Poke,
+        &&target_Pop, &&target_PopLn, &&target_PopAll, &&target_PopAllLn,
+        &&target_Print,
+        &&target_PushInt, &&target_PushString,
+        &&target_QDisplay,
+        &&target_Read, &&target_ReadAll,
+        &&target_Ret,
+        &&target_SortDown, &&target_SortUp,
+        &&target_Sub, &&target_SubK,
+        &&target_PushAdd, &&target_PushSub, &&target_PushMul, &&target_PushDiv, &&target_PushMod,
+        &&target_IfEqGoto, &&target_IfGtGoto, &&target_IfLtGoto, &&target_IfNqGoto,
+        &&target_Halt,
+    };
+    static_assert(sizeof(handlers) / sizeof(handlers[0]) == static_cast<size_t>(Opcode::Halt) + 1, "Every opcode needs a handler.");
+#define TARGET(op) case Opcode::op: target_##op
+#define DISPATCH() do { if (Threaded) goto *handlers[static_cast<size_t>(ip->opcode)]; else goto dispatch; } while (0)
+#else
+#define TARGET(op) case Opcode::op
+#define DISPATCH() goto dispatch
+#endif
+#define CHECK(success) do { if (QU_UNLIKELY(!(success))) return -1; } while (0)
+#define NEXT() do { RuntimeMetrics::instructions_retired++; ip++; DISPATCH(); } while (0)
+#define JUMP_TO(target) do { \
+        RuntimeMetrics::instructions_retired++; \
+        RuntimeMetrics::poll(program_queue); \
+        ip = code + (target); \
+        DISPATCH(); \
+    } while (0)
+// A jump from index back to target closes a loop, which the JIT may run natively and then send this loop on from wherever it stopped.
+#define JUMP(index, target) do { \
+        size_t jit_resume = 0; \
+        if (Jitted && (target) <= (index) && jit->backEdge(index, program_queue, jit_resume)) JUMP_TO(jit_resume); \
+        JUMP_TO(target); \
+    } while (0)
+// Both operands are popped before a division by zero is reported, as OperationHandler does.
+#define BINARY(op) do { \
+        CHECK(enoughArguments(program_queue, 2, ip->line, error_handler)); \
+        popTwo(program_queue, first, second); \
+        program_queue.push(first op second); \
+    } while (0)
+#define BINARY_K(op) do { \
+        CHECK(enoughArguments(program_queue, 2, ip->line, error_handler)); \
+        program_queue.push(program_queue.peek(0) op program_queue.peek(1)); \
+    } while (0)
+#define DIVIDING(op) do { \
+        CHECK(enoughArguments(program_queue, 2, ip->line, error_handler)); \
+        popTwo(program_queue, first, second); \
+        if (QU_UNLIKELY(second == 0)) { \
+            error_handler.divisionByZero(ip->line); \
+            return -1; \
+        } \
+        program_queue.push(first op second); \
+    } while (0)
+#define DIVIDING_K(op) do { \
+        CHECK(enoughArguments(program_queue, 2, ip->line, error_handler)); \
+        if (QU_UNLIKELY(program_queue.peek(1) == 0)) { \
+            error_handler.divisionByZero(ip->line); \
+            return -1; \
+        } \
+        program_queue.push(program_queue.peek(0) op program_queue.peek(1)); \
+    } while (0)
+#define IF(comparison) do { \
+        CHECK(enoughArguments(program_queue, 2, ip->line, error_handler)); \
+        if (program_queue.peek(0) comparison program_queue.peek(1)) JUMP(ip - code, ip->int_operand); \
+    } while (0)
+
+    const Instruction* const code = program.code.data();
+    const Instruction* ip = code;
+    int64_t first, second;
+    DISPATCH();
+
+dispatch:
+    switch (ip->opcode) {
+    TARGET(Add):
+        BINARY(+);
+        NEXT();
+
+    TARGET(AddK):
+        BINARY_K(+);
+        NEXT();
+
+    TARGET(Div):
+        DIVIDING(/);
+        NEXT();
+
+    TARGET(DivK):
+        DIVIDING_K(/);
+        NEXT();
+
+    TARGET(Empty):
+        NEXT();
+
+    TARGET(Goto):
+        JUMP(ip - code, ip->int_operand);
+
+    TARGET(IfEq):
+        IF(==);
+        NEXT();
+
+    TARGET(IfGt):
+        IF(>);
+        NEXT();
+
+    TARGET(IfLt):
+        IF(<);
+        NEXT();
+
+    TARGET(IfNq):
+        IF(!=);
+        NEXT();
+
+    TARGET(Mod):
+        DIVIDING(%);
+        NEXT();
+
+    TARGET(ModK):
+        DIVIDING_K(%);
+        NEXT();
+
+    TARGET(Mul):
+        BINARY(*);
+        NEXT();
+
+    TARGET(MulK):
+        BINARY_K(*);
+        NEXT();
+
+    TARGET(Peek):
+        CHECK(enoughArguments(program_queue, 1, ip->line, error_handler));
+        output.writeInt(program_queue.front());
+        NEXT();
+
+    TARGET(PeekLn):
+        CHECK(enoughArguments(program_queue, 1, ip->line, error_handler));
+        output.writeInt(program_queue.front());
+        output.endLine();
+        NEXT();
+
+    TARGET(Poke):
+        random.shuffle(program_queue.linearize(), program_queue.size());
+        NEXT();
+
+    TARGET(Pop):
+        CHECK(enoughArguments(program_queue, 1, ip->line, error_handler));
+        output.writeInt(program_queue.front());
+        program_queue.pop();
+        NEXT();
+
+    TARGET(PopLn):
+        CHECK(enoughArguments(program_queue, 1, ip->line, error_handler));
+        output.writeInt(program_queue.front());
+        output.endLine();
+        program_queue.pop();
+        NEXT();
+
+    TARGET(PopAll):
+        while (!program_queue.empty()) {
+            output.writeInt(program_queue.front());
+            program_queue.pop();
+        }
+        NEXT();
+
+    TARGET(PopAllLn):
+        while (!program_queue.empty()) {
+            output.writeInt(program_queue.front());
+            output.endLine();
+            program_queue.pop();
+        }
+        NEXT();
+
+    TARGET(Print):
+        output.write(program.strings[ip->int_operand]);
+        output.endLine();
+        NEXT();
+
+    TARGET(PushInt):
+        pushInt(program_queue, ip->int_operand, output, verbose);
+        NEXT();
+
+    // TypeInference keeps every program that can reach one of these off this engine.
+    TARGET(PushString):
+    TARGET(Read):
+    TARGET(ReadAll):
+        error_handler.unknownInstruction(ip->line);
+        return -1;
+
+    TARGET(QDisplay):
+        QueueWriter::write(output, program_queue, static_cast<DisplayFormat>(ip->int_operand));
+        output.endLine();
+        NEXT();
+
+    TARGET(Ret): {
+        if (QU_UNLIKELY(program_queue.empty())) {
+            error_handler.returnFromEmptyQueue(ip->line);
+            return -1;
+        }
+        int64_t value = program_queue.front();
+        program_queue.pop();
+        RuntimeMetrics::instructions_retired++;
+        return static_cast<int>(value);
+    }
+
+    TARGET(SortDown):
+    TARGET(SortUp):
+        SortEngine::sort(program_queue.linearize(), program_queue.size(), ip->opcode == Opcode::SortUp);
+        NEXT();
+
+    TARGET(Sub):
+        BINARY(-);
+        NEXT();
+
+    TARGET(SubK):
+        BINARY_K(-);
+        NEXT();
+
+    TARGET(PushAdd):
+        pushInt(program_queue, ip->int_operand, output, verbose);
+        BINARY(+);
+        NEXT();
+
+    TARGET(PushSub):
+        pushInt(program_queue, ip->int_operand, output, verbose);
+        BINARY(-);
+        NEXT();
+
+    TARGET(PushMul):
+        pushInt(program_queue, ip->int_operand, output, verbose);
+        BINARY(*);
+        NEXT();
+
+    TARGET(PushDiv):
+        pushInt(program_queue, ip->int_operand, output, verbose);
+        DIVIDING(/);
+        NEXT();
+
+    TARGET(PushMod):
+        pushInt(program_queue, ip->int_operand, output, verbose);
+        DIVIDING(%);
+        NEXT();
+
+    // The GOTO after a fused IF* is never run itself, the IF* jumps straight to its target instead.
+    TARGET(IfEqGoto):
+        IF(==);
+        JUMP(ip + 1 - code, (ip + 1)->int_operand);
+
+    TARGET(IfGtGoto):
+        IF(>);
+        JUMP(ip + 1 - code, (ip + 1)->int_operand);
+
+    TARGET(IfLtGoto):
+        IF(<);
+        JUMP(ip + 1 - code, (ip + 1)->int_operand);
+
+    TARGET(IfNqGoto):
+        IF(!=);
+        JUMP(ip + 1 - code, (ip + 1)->int_operand);
+
+    TARGET(Halt):
+        return 0;
+    }
+
+#undef TARGET
+#undef DISPATCH
+#undef CHECK
+#undef NEXT
+#undef JUMP_TO
+#undef JUMP
+#undef BINARY
+#undef BINARY_K
+#undef DIVIDING
+#undef DIVIDING_K
+#undef IF
+    return 0;
+}
+
+/**
+ * Checks whether a run can go on the integer engine.
+ *
+ * @param program The decoded program.
+ * @param program_queue The queue the program starts with, which must hold nothing but integers too.
+ * @return true if the program was proved to only ever hold integers and the queue only holds integers.
+ */
+bool IntExecutor::accepts(const Program& program, const RingQueue<node>& program_queue) {
+    if (!program.integer_only) return false;
+    for (size_t i = 0; i < program_queue.size(); i++) {
+        if (!program_queue.peek(i).containsInt()) return false;
+    }
+    return true;
+}
+
+/**
+ * Runs a program on a queue of plain integers.
+ * The queue of nodes is moved into the integer queue before the program starts and back once it stops, however it stops,
+ * so the caller sees the same queue either engine would have left.
+ *
+ * @param program The decoded program, which accepts must have let through with this queue.
+ * @param program_queue The queue for the program itself.
+ * @param error_handler The interpreter's error handler.
+ * @param output Where the program's output goes.
+ * @param random Where POKE gets its random numbers.
+ * @param mode How to dispatch instructions. Threaded dispatch falls back to the switch loop when it isn't available.
+ * @param verbose Whether to trace what the program pushes.
+ * @param jit When not null, the JIT the program's loops are reported to.
+ * @return The value returned by RET, 0 if the program ran off its end, or -1 if it stopped on an error (which error_handler holds).
+ */
+int IntExecutor::run(const Program& program, RingQueue<node>& program_queue, errorHandler& error_handler, OutputSink& output, RandomSource& random, DispatchMode mode, bool verbose, JitEngine* jit) {
+    RingQueue<int64_t> int_queue;
+    for (size_t i = 0; i < program_queue.size(); i++) int_queue.push(program_queue.peek(i).getInt());
+    program_queue.clear();
+
+    bool threaded = QU_THREADED_DISPATCH && mode == DispatchMode::Threaded;
+    int result;
+    if (jit != nullptr) {
+        result = threaded
+            ? execute<true, true>(program, int_queue, error_handler, output, random, verbose, jit)
+            : execute<false, true>(program, int_queue, error_handler, output, random, verbose, jit);
+    } else {
+        result = threaded
+            ? execute<true, false>(program, int_queue, error_handler, output, random, verbose, nullptr)
+            : execute<false, false>(program, int_queue, error_handler, output, random, verbose, nullptr);
+    }
+
+    for (size_t i = 0; i < int_queue.size(); i++) program_queue.push(node(int_queue.peek(i)));
+    program_queue.absorbStats(int_queue);
+    return result;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include "executor.h"
+
+class JitEngine;
+
+/**
+ * The execution loop for programs TypeInference has proved only ever hold integers.
+ *
+ * The queue is a RingQueue of plain int64_t values: no tags, no string storage, and none of the type checks OperationHandler
+ * makes, so arithmetic is just the operation itself and the queue is eight bytes an element rather than sixteen. Every
+ * instruction does exactly what it does on the node queue and reports the same errors at the same lines, so which engine
+ * ran a program can't be told from its output.
+ */
+class IntExecutor {
+public:
+    static bool accepts(const Program& program, const RingQueue<node>& program_queue);
+    static int run(const Program& program, RingQueue<node>& program_queue, errorHandler& error_handler, OutputSink& output, RandomSource& random, DispatchMode mode, bool verbose, JitEngine* jit = nullptr);
+};
@@ -0,0 +1,108 @@
+#include "inputReader.h"
+
+#include <charconv>
+#include <cstring>
+#include <string>
+#ifdef _WIN32
+#include <io.h>
+#define read _read
+#else
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+/**
+ * Creates a reader over a file descriptor.
+ *
+ * @param fd The file descriptor to read from, usually 0 for stdin.
+ */
+InputReader::InputReader(int fd) : fd(fd), buffer(BUFFER_SIZE) {}
+
+/**
+ * Creates a reader over text in memory, which is all read in already.
+ *
+ * @param text The whole input, copied so it doesn't have to outlive the reader.
+ */
+InputReader::InputReader(string_view text) : fd(-1), buffer(text.size() + 1), end(text.size()), at_end(true) {
+    // The extra byte only keeps the buffer from being empty.
+    if (!text.empty()) memcpy(buffer.data(), text.data(), text.size());
+}
+
+/**
+ * Reads more of the input into the buffer, after the bytes that haven't been returned yet.
+ *
+ * @return true if anything was read, false at the end of the input.
+ */
+bool InputReader::fill() {
+    if (at_end) return false;
+
+    // Move what's left to the front, and make room if it already fills the buffer
+    if (start > 0) {
+        memmove(buffer.data(), buffer.data() + start, end - start);
+        end -= start;
+        start = 0;
+    }
+    if (end == buffer.size()) buffer.resize(buffer.size() * 2);
+
+    // A single read, so an interactive user isn't made to fill the whole buffer
+    auto count = read(fd, buffer.data() + end, static_cast<unsigned>(buffer.size() - end));
+    if (count <= 0) {
+        at_end = true;
+        return false;
+    }
+    end += count;
+    return true;
+}
+
+/**
+ * Reads the next line of input, without its line ending.
+ *
+ * @param line Receives the line, which stays valid until the next call.
+ * @return true if a line was read, false at the end of the input.
+ */
+bool InputReader::readLine(string_view& line) {
+    size_t searched = start;
+    while (true) {
+        const char* newline = static_cast<const char*>(memchr(buffer.data() + searched, '\n', end - searched));
+        if (newline != nullptr) {
+            size_t length = newline - (buffer.data() + start);
+            line = string_view(buffer.data() + start, length);
+            start += length + 1;
+            break;
+        }
+
+        searched = end - start; // Everything so far has been searched, and fill() moves it to the front.
+        if (!fill()) {
+            if (start == end) return false;
+            line = string_view(buffer.data() + start, end - start); // The last line has no line ending
+            start = end;
+            break;
+        }
+    }
+
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    return true;
+}
+
+/**
+ * Turns a line of input into a node, an integer if the line starts with one and a string otherwise.
+ * This never throws, lines that aren't integers (or are too big to be one) are simply strings.
+ *
+ * @param line The line of input.
+ * @return The node to push onto the queue.
+ */
+node InputReader::toNode(string_view line) {
+    // Like stoi, leading whitespace and a sign are allowed and anything after the digits is ignored
+    size_t first = line.find_first_not_of(" \t\n\v\f\r");
+    if (first != string_view::npos) {
+        const char* digits = line.data() + first;
+        const char* last = line.data() + line.size();
+        if (*digits == '+' && digits + 1 < last && *(digits + 1) != '-') digits++;
+
+        int64_t value;
+        auto result = from_chars(digits, last, value);
+        if (result.ec == errc()) return node(value);
+    }
+    return node(string(line));
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "../node/node.h"
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/**
+ * Reads the lines a program is given as input, straight from a file descriptor through a large buffer,
+ * or from text already in memory when the interpreter is embedded.
+ */
+class InputReader {
+private:
+    static constexpr size_t BUFFER_SIZE = 1 << 16;
+
+    int fd;                   // The file descriptor lines are read from, -1 when reading from memory.
+    std::vector<char> buffer; // Grows if a single line doesn't fit.
+    size_t start = 0;         // The first byte not yet returned as part of a line.
+    size_t end = 0;           // One past the last byte read into the buffer.
+    bool at_end = false;      // True once the file descriptor has nothing more to give.
+
+    bool fill();
+public:
+    explicit InputReader(int fd);
+    explicit InputReader(std::string_view text);
+
+    bool readLine(std::string_view& line);
+    static node toNode(std::string_view line);
+};
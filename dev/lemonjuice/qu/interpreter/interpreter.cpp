@@ -0,0 +1,195 @@
+#include "interpreter.h"
+
+#include <utility>
+#include "../analysis/typeInference.h"
+#include "../compiler/compiler.h"
+#include "../optimizer/optimizer.h"
+
+using namespace std;
+
+/**
+ * Creates an interpreter with an empty program, seeded from the system.
+ */
+Interpreter::Interpreter() : random(RandomSource::systemSeed()) {
+    compile(vector<string_view>());
+}
+
+/**
+ * Compiles the text of a program, replacing any program loaded before.
+ *
+ * @param source The whole text of the program.
+ * @param optimization_level How far to optimize the program, 0 to not optimize it.
+ * @return true if it compiled, false if it had an error, in which case the program loaded before is kept.
+ */
+bool Interpreter::compile(string_view source, int optimization_level) {
+    // Split the same way a SourceFile does: on '\n', with no empty line after a final newline.
+    vector<string_view> lines;
+    while (!source.empty()) {
+        size_t newline = source.find('\n');
+        lines.push_back(source.substr(0, newline));
+        if (newline == string_view::npos) break;
+        source.remove_prefix(newline + 1);
+    }
+    return compile(lines, optimization_level);
+}
+
+/**
+ * Compiles the lines of a program, replacing any program loaded before.
+ *
+ * @param lines The lines of the program, which only have to stay valid during the call.
+ * @param optimization_level How far to optimize the program, 0 to not optimize it.
+ * @return true if it compiled, false if it had an error, in which case the program loaded before is kept.
+ */
+bool Interpreter::compile(const vector<string_view>& lines, int optimization_level) {
+    error_handler.clear();
+    Program compiled = Compiler::compile(lines, error_handler);
+    if (error_handler.failed()) return false;
+    Optimizer::optimize(compiled, optimization_level);
+    load(std::move(compiled));
+    return true;
+}
+
+/**
+ * Loads an already compiled program, such as one read from a .quc file, replacing any program loaded before.
+ *
+ * @param compiled The program.
+ */
+void Interpreter::load(Program compiled) {
+    program = prepare(std::move(compiled));
+}
+
+/**
+ * Loads a program made ready by prepare, which any number of interpreters can share.
+ *
+ * @param compiled The program.
+ */
+void Interpreter::load(shared_ptr<const Program> compiled) {
+    program = std::move(compiled);
+}
+
+/**
+ * Makes a compiled program ready to be shared between interpreters, after which it is never changed.
+ *
+ * @param compiled The program.
+ * @return The program, ready to load.
+ */
+shared_ptr<const Program> Interpreter::prepare(Program compiled) {
+    Executor::bindHandlers(compiled); // Binding is cheap, and leaves every dispatch mode ready to use.
+    compiled.integer_only = TypeInference::integerOnly(compiled);
+    return make_shared<const Program>(std::move(compiled));
+}
+
+const Program& Interpreter::getProgram() const {
+    return *program;
+}
+
+void Interpreter::setDispatchMode(DispatchMode mode) {
+    dispatch_mode = mode;
+}
+
+/**
+ * @param verbose Whether to trace what the program pushes, to its output.
+ */
+void Interpreter::setVerbose(bool verbose) {
+    this->verbose = verbose;
+}
+
+/**
+ * @param jit Whether to compile hot loops to native code, where that is supported.
+ */
+void Interpreter::setJit(bool jit) {
+    this->jit = jit;
+}
+
+/**
+ * @param profiler When not null, runs use the profiled build and this collects the profile. It must outlive the runs.
+ */
+void Interpreter::setProfiler(Profiler* profiler) {
+    this->profiler = profiler;
+}
+
+/**
+ * Reseeds the generator POKE shuffles with, so runs can be repeated exactly.
+ *
+ * @param seed The seed.
+ */
+void Interpreter::seed(uint64_t seed) {
+    random.seed(seed);
+}
+
+/**
+ * @param policy Whether errors end the process, or are kept for the caller (the default).
+ */
+void Interpreter::setErrorPolicy(ErrorPolicy policy) {
+    error_handler.setPolicy(policy);
+}
+
+/**
+ * @return true if the last compile or run stopped on an error.
+ */
+bool Interpreter::failed() const {
+    return error_handler.failed();
+}
+
+ErrorCode Interpreter::getErrorCode() const {
+    return error_handler.getCode();
+}
+
+/**
+ * @return The message of the error the last compile or run stopped on, empty if it didn't.
+ */
+const string& Interpreter::getErrorMessage() const {
+    return error_handler.getMessage();
+}
+
+/**
+ * Prints the error the last compile or run stopped on to stderr, as the command line reports errors.
+ */
+void Interpreter::reportError() const {
+    error_handler.report();
+}
+
+/**
+ * Gets the queue, as the last run left it or to fill before the next run.
+ *
+ * @return The queue.
+ */
+RingQueue<node>& Interpreter::queue() {
+    return program_queue;
+}
+
+const RingQueue<node>& Interpreter::queue() const {
+    return program_queue;
+}
+
+/**
+ * Runs the loaded program.
+ *
+ * @param input Where the program's input comes from.
+ * @param output Where the program's output goes.
+ * @param keep_queue Whether to start from the queue as it is, rather than an empty one.
+ * @return The value returned by RET, 0 if the program ran off its end, or -1 if it stopped on an error.
+ */
+int Interpreter::run(InputReader& input, OutputSink& output, bool keep_queue) {
+    error_handler.clear();
+    if (!keep_queue) {
+        program_queue.clear();
+        arena.reset(); // Only rewinds once every string of the last run is gone.
+    }
+    StringArena::Scope scope(arena);
+    return Executor::run(*program, program_queue, error_handler, input, output, random, dispatch_mode, verbose, profiler, jit);
+}
+
+/**
+ * Runs the loaded program on input in memory, capturing its output.
+ *
+ * @param input The whole input of the program.
+ * @param output Receives everything the program prints, appended to what it already holds.
+ * @param keep_queue Whether to start from the queue as it is, rather than an empty one.
+ * @return The value returned by RET, 0 if the program ran off its end, or -1 if it stopped on an error.
+ */
+int Interpreter::run(string_view input, string& output, bool keep_queue) {
+    InputReader reader(input);
+    OutputSink sink(output); // Flushed into output when it goes out of scope.
+    return run(reader, sink, keep_queue);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../compiler/instruction.h"
+#include "../error/errorHandler.h"
+#include "../executor/executor.h"
+#include "../input/inputReader.h"
+#include "../node/node.h"
+#include "../node/stringArena.h"
+#include "../output/outputSink.h"
+#include "../profile/profiler.h"
+#include "../queue/ringQueue.h"
+#include "../random/randomSource.h"
+
+/**
+ * Everything it takes to run a program, for embedding the interpreter in another program through libqu.
+ * A program is compiled (or loaded) once and can then be run any number of times, each run starting from an empty queue
+ * or from whatever the last run left on it. An Interpreter holds all of its own state, so any number of them can be used
+ * at once, as long as each one is only used by one thread at a time. Interpreters on different threads can share one
+ * compiled program, which is never changed once it is loaded.
+ *
+ * The long strings a run makes come from an arena of the interpreter's own, which is rewound whenever a run starts from an
+ * empty queue, so strings made by a run must not outlive the Interpreter.
+ *
+ * Errors, in compiling or running a program, don't end the process: the call that hit one gives up and the error is kept
+ * until the next call, unless the Exit policy is asked for.
+ *
+ *   Interpreter interpreter;
+ *   interpreter.compile("READ \"\"\nPUSH 1\nADD\nRET");
+ *   std::string output;
+ *   int result = interpreter.run("41\n", output); // 42
+ */
+class Interpreter {
+private:
+    std::shared_ptr<const Program> program;
+    errorHandler error_handler{ErrorPolicy::Return};
+    StringArena arena; // The long strings of every run, declared before the queue so it outlives the strings on it.
+    RingQueue<node> program_queue;
+    RandomSource random;
+    DispatchMode dispatch_mode = QU_THREADED_DISPATCH ? DispatchMode::Threaded : DispatchMode::Switch;
+    bool verbose = false;
+    bool jit = false;
+    Profiler* profiler = nullptr;
+public:
+    Interpreter();
+
+    bool compile(std::string_view source, int optimization_level = 0);
+    bool compile(const std::vector<std::string_view>& lines, int optimization_level = 0);
+    void load(Program compiled);
+    void load(std::shared_ptr<const Program> compiled);
+    static std::shared_ptr<const Program> prepare(Program compiled);
+    const Program& getProgram() const;
+
+    void setDispatchMode(DispatchMode mode);
+    void setVerbose(bool verbose);
+    void setJit(bool jit);
+    void setProfiler(Profiler* profiler);
+    void seed(uint64_t seed);
+    void setErrorPolicy(ErrorPolicy policy);
+
+    bool failed() const;
+    ErrorCode getErrorCode() const;
+    const std::string& getErrorMessage() const;
+    void reportError() const;
+
+    RingQueue<node>& queue();
+    const RingQueue<node>& queue() const;
+
+    int run(InputReader& input, OutputSink& output, bool keep_queue = false);
+    int run(std::string_view input, std::string& output, bool keep_queue = false);
+};
@@ -0,0 +1,434 @@
+#include "jitEngine.h"
+
+#include <cstring>
+#include "../metrics/runtimeMetrics.h"
+#if QU_JIT_AVAILABLE
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#if QU_JIT_AVAILABLE
+/*
+ * The compiled code keeps everything in caller saved registers, so it needs no prologue beyond loading its state:
+ *   rdi  the ring of unboxed integers        rsi  the state array
+ *   r8   the ring slot of the queue's front  r9   the iterations run so far
+ *   rax, rcx, rdx  the operands              r10  the address of the slot being loaded or stored
+ * An element of the queue is found by its position from the front, position p sitting in ring slot (r8 + p) % RING_SIZE.
+ */
+
+// Conditional jump opcodes, the second byte of a Jcc rel32.
+static const uint8_t JUMP_IF_EQUAL = 0x84;
+static const uint8_t JUMP_IF_NOT_EQUAL = 0x85;
+static const uint8_t JUMP_IF_LESS = 0x8C;
+static const uint8_t JUMP_IF_GREATER = 0x8F;
+
+// rax and rcx are the only registers loaded from and stored to the ring.
+enum Register : uint8_t { RAX = 0, RCX = 1 };
+
+/**
+ * Builds x86-64 machine code, one instruction at a time.
+ */
+class Assembler {
+public:
+    vector<uint8_t> bytes;
+
+    void emit(initializer_list<uint8_t> code) { bytes.insert(bytes.end(), code); }
+
+    void emit32(uint32_t value) {
+        for (int i = 0; i < 4; i++) bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    void emit64(uint64_t value) {
+        for (int i = 0; i < 8; i++) bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    /**
+     * r10 = the ring slot of a queue position.
+     *
+     * @param position The position from the front of the queue.
+     */
+    void slotAddress(size_t position) {
+        emit({0x4D, 0x8D, 0x90}); // lea r10, [r8 + position]
+        emit32(static_cast<uint32_t>(position));
+        emit({0x41, 0x83, 0xE2, static_cast<uint8_t>(JitEngine::ringMask())}); // and r10d, mask
+    }
+
+    void load(Register destination, size_t position) {
+        slotAddress(position);
+        emit({0x4A, 0x8B, static_cast<uint8_t>(0x04 | destination << 3), 0xD7}); // mov reg, [rdi + r10 * 8]
+    }
+
+    void store(Register source, size_t position) {
+        slotAddress(position);
+        emit({0x4A, 0x89, static_cast<uint8_t>(0x04 | source << 3), 0xD7}); // mov [rdi + r10 * 8], reg
+    }
+
+    /**
+     * Moves the front of the queue back, dropping elements from it.
+     *
+     * @param popped How many elements were popped.
+     */
+    void pop(uint8_t popped) {
+        emit({0x49, 0x83, 0xC0, popped});                                       // add r8, popped
+        emit({0x41, 0x83, 0xE0, static_cast<uint8_t>(JitEngine::ringMask())}); // and r8d, mask
+    }
+
+    /**
+     * Emits a conditional jump to be patched once its target is known.
+     *
+     * @param condition The second opcode byte of the jump.
+     * @return Where the jump's offset has to be written.
+     */
+    size_t jumpIf(uint8_t condition) {
+        emit({0x0F, condition});
+        emit32(0);
+        return bytes.size() - 4;
+    }
+
+    /**
+     * Emits an unconditional jump to be patched once its target is known.
+     *
+     * @return Where the jump's offset has to be written.
+     */
+    size_t jump() {
+        emit({0xE9});
+        emit32(0);
+        return bytes.size() - 4;
+    }
+
+    void patch(size_t offset_at, size_t target) {
+        uint32_t offset = static_cast<uint32_t>(static_cast<int64_t>(target) - static_cast<int64_t>(offset_at + 4));
+        memcpy(bytes.data() + offset_at, &offset, 4);
+    }
+};
+
+/**
+ * Gets which arithmetic instruction an opcode does, leaving out any PUSH fused into it.
+ *
+ * @param opcode The opcode.
+ * @return The unfused opcode.
+ */
+static Opcode arithmeticOf(Opcode opcode) {
+    switch (opcode) {
+        case Opcode::PushAdd: return Opcode::Add;
+        case Opcode::PushSub: return Opcode::Sub;
+        case Opcode::PushMul: return Opcode::Mul;
+        case Opcode::PushDiv: return Opcode::Div;
+        case Opcode::PushMod: return Opcode::Mod;
+        default: return opcode;
+    }
+}
+
+/**
+ * Gets the conditional jump that does what an IF* does, once the first two elements are in rax and rcx.
+ *
+ * @param opcode The opcode of the IF*.
+ * @param condition Receives the second opcode byte of the jump.
+ * @return false if the opcode isn't an IF*.
+ */
+static bool jumpCondition(Opcode opcode, uint8_t& condition) {
+    switch (opcode) {
+        case Opcode::IfEq: case Opcode::IfEqGoto: condition = JUMP_IF_EQUAL; return true;
+        case Opcode::IfGt: case Opcode::IfGtGoto: condition = JUMP_IF_GREATER; return true;
+        case Opcode::IfLt: case Opcode::IfLtGoto: condition = JUMP_IF_LESS; return true;
+        case Opcode::IfNq: case Opcode::IfNqGoto: condition = JUMP_IF_NOT_EQUAL; return true;
+        default: return false;
+    }
+}
+
+/**
+ * Checks whether an opcode is an IF* fused with the GOTO after it.
+ *
+ * @param opcode The opcode.
+ * @return true for IfEqGoto, IfGtGoto, IfLtGoto and IfNqGoto.
+ */
+static bool fusedWithGoto(Opcode opcode) {
+    return opcode == Opcode::IfEqGoto || opcode == Opcode::IfGtGoto || opcode == Opcode::IfLtGoto || opcode == Opcode::IfNqGoto;
+}
+
+/**
+ * Gets an element of the queue as an integer the compiled code can work on.
+ *
+ * @param element The element.
+ * @param value Receives its integer.
+ * @return false if the element isn't an integer.
+ */
+static bool unboxed(const node& element, int64_t& value) {
+    if (!element.containsInt()) return false;
+    value = element.getInt();
+    return true;
+}
+
+static bool unboxed(int64_t element, int64_t& value) {
+    value = element;
+    return true;
+}
+#endif
+
+/**
+ * Creates the JIT for a program, which compiles nothing until a loop gets hot.
+ *
+ * @param program The program being run, which must outlive the JIT.
+ */
+JitEngine::JitEngine(const Program& program) : program(program), loops(program.code.size()) {}
+
+/**
+ * Frees the executable memory of every compiled loop.
+ */
+JitEngine::~JitEngine() {
+#if QU_JIT_AVAILABLE
+    for (const pair<void*, size_t>& mapping : mappings) munmap(mapping.first, mapping.second);
+#endif
+}
+
+/**
+ * Checks whether native code can be generated on this platform at all.
+ *
+ * @return true on x86-64 Linux.
+ */
+bool JitEngine::available() {
+    return QU_JIT_AVAILABLE;
+}
+
+/**
+ * Called by the interpreter each time it is about to take a backward jump. Counts the jump, compiles the loop it closes once it is
+ * hot, and when there is native code for the loop and the queue suits it, runs the loop natively.
+ *
+ * @param index The instruction index of the jump.
+ * @param program_queue The queue for the program itself, updated as if the interpreter had run the loop.
+ * @param resume Receives the instruction index the interpreter carries on from.
+ * @return true if the loop ran natively, false if the interpreter should take the jump itself.
+ */
+bool JitEngine::backEdge(size_t index, RingQueue<node>& program_queue, size_t& resume) {
+    return enter(index, program_queue, resume);
+}
+
+/**
+ * Called by the IntExecutor each time it is about to take a backward jump, as above.
+ *
+ * @param index The instruction index of the jump.
+ * @param program_queue The queue of plain integers, updated as if the interpreter had run the loop.
+ * @param resume Receives the instruction index the interpreter carries on from.
+ * @return true if the loop ran natively, false if the interpreter should take the jump itself.
+ */
+bool JitEngine::backEdge(size_t index, RingQueue<int64_t>& program_queue, size_t& resume) {
+    return enter(index, program_queue, resume);
+}
+
+/**
+ * Counts a backward jump and runs the loop it closes natively when it can, for either kind of queue.
+ *
+ * @param index The instruction index of the jump.
+ * @param program_queue The queue for the program itself.
+ * @param resume Receives the instruction index the interpreter carries on from.
+ * @return true if the loop ran natively.
+ */
+template <typename T>
+bool JitEngine::enter(size_t index, RingQueue<T>& program_queue, size_t& resume) {
+#if QU_JIT_AVAILABLE
+    Loop& loop = loops[index];
+    if (loop.rejected) return false;
+    if (loop.code == nullptr) {
+        if (++loop.taken < HOT_THRESHOLD) return false;
+        if (!compile(index, program_queue.size(), loop)) {
+            loop.rejected = true;
+            return false;
+        }
+    }
+
+    // The code only knows the queue it was compiled for: this many elements, all of them integers.
+    size_t entry_size = loop.entry_size;
+    if (program_queue.size() != entry_size) return false;
+    for (size_t i = 0; i < entry_size; i++) {
+        if (!unboxed(program_queue.peek(i), ring[i])) return false;
+    }
+
+    uint64_t state[3] = {0, 0, 0};
+    resume = static_cast<size_t>(loop.code(ring, state));
+    size_t head = state[0];
+    uint64_t iterations = state[1];
+    size_t stop = state[2];
+
+    // Account for every instruction the interpreter would have run, and leave the queue as it would have.
+    size_t start = static_cast<size_t>(program.code[index].int_operand);
+    RuntimeMetrics::instructions_retired += iterations * loop.length + (stop - start);
+    size_t exit_size = loop.sizes[stop - start];
+    for (size_t i = 0; i < entry_size; i++) program_queue.pop();
+    for (size_t i = 0; i < exit_size; i++) program_queue.push(T(ring[(head + i) & ringMask()]));
+    return true;
+#else
+    (void) index;
+    (void) program_queue;
+    (void) resume;
+    return false;
+#endif
+}
+
+/**
+ * Compiles the loop closed by a backward jump, if it is nothing but integer pushes, arithmetic and IF*s jumping out of the loop,
+ * closed by an IF* or a GOTO.
+ * Where each element lives is worked out here, from the queue's size when the loop starts, so it has to be the same on every entry.
+ *
+ * @param back_edge The instruction index of the IF* or GOTO jumping back to the start of the loop.
+ * @param entry_size The size of the queue at the start of the loop.
+ * @param loop Receives the compiled loop.
+ * @return false if the loop can't be compiled.
+ */
+bool JitEngine::compile(size_t back_edge, size_t entry_size, Loop& loop) {
+#if QU_JIT_AVAILABLE
+    const Instruction& closing = program.code[back_edge];
+    size_t start = static_cast<size_t>(closing.int_operand);
+    bool unconditional = closing.opcode == Opcode::Goto;
+    uint8_t condition = 0;
+    if ((!unconditional && !jumpCondition(closing.opcode, condition)) || start > back_edge || entry_size > RING_SIZE) return false;
+
+    // Every way out of the loop returns to the interpreter through one of these.
+    struct Exit {
+        size_t jump;   // Where the offset of the jump out has to be written.
+        size_t resume; // The instruction index the interpreter resumes from.
+        size_t stop;   // The instructions of the loop before this one ran in the last iteration.
+    };
+    Assembler assembler;
+    vector<Exit> exits;
+    bool leaves = false; // Whether an IF* in the body can jump out, without which a loop closed by a GOTO never ends.
+    assembler.emit({0x4C, 0x8B, 0x06}); // mov r8, [rsi]
+    assembler.emit({0x45, 0x31, 0xC9}); // xor r9d, r9d
+    size_t loop_start = assembler.bytes.size();
+
+    size_t size = entry_size;
+    for (size_t index = start; index < back_edge; index++) {
+        const Instruction& instruction = program.code[index];
+        loop.sizes.push_back(size);
+        Opcode opcode = arithmeticOf(instruction.opcode);
+        bool fused = opcode != instruction.opcode;
+
+        if (instruction.opcode == Opcode::Empty) continue;
+        // An IF* in the body has to jump out of the loop. A fused one falls through to its GOTO, which must be the one closing it.
+        uint8_t exit_condition = 0;
+        if (jumpCondition(instruction.opcode, exit_condition)) {
+            size_t target = static_cast<size_t>(instruction.int_operand);
+            if (fusedWithGoto(instruction.opcode) && index + 1 != back_edge) return false;
+            if ((target >= start && target <= back_edge) || size < 2) return false;
+            assembler.load(RAX, 0);
+            assembler.load(RCX, 1);
+            assembler.emit({0x48, 0x39, 0xC8}); // cmp rax, rcx
+            exits.push_back({assembler.jumpIf(exit_condition), target, index + 1});
+            leaves = true;
+            continue;
+        }
+        if (instruction.opcode == Opcode::PushInt || fused) {
+            if (size + 1 > RING_SIZE) return false;
+            assembler.emit({0x48, 0xB8}); // mov rax, value
+            assembler.emit64(static_cast<uint64_t>(instruction.int_operand));
+            assembler.store(RAX, size++);
+            if (!fused) continue;
+        }
+
+        bool keeps_operands = false;
+        switch (opcode) {
+            case Opcode::AddK: case Opcode::SubK: case Opcode::MulK: case Opcode::DivK: case Opcode::ModK:
+                keeps_operands = true;
+                break;
+            case Opcode::Add: case Opcode::Sub: case Opcode::Mul: case Opcode::Div: case Opcode::Mod:
+                break;
+            default:
+                return false;
+        }
+        // Too few elements fails on every iteration, so it is left to the interpreter rather than compiled as a deopt.
+        if (size < 2 || size + 1 > RING_SIZE) return false;
+
+        assembler.load(RAX, 0);
+        assembler.load(RCX, 1);
+        switch (opcode) {
+            case Opcode::Add: case Opcode::AddK:
+                assembler.emit({0x48, 0x01, 0xC8}); // add rax, rcx
+                break;
+            case Opcode::Sub: case Opcode::SubK:
+                assembler.emit({0x48, 0x29, 0xC8}); // sub rax, rcx
+                break;
+            case Opcode::Mul: case Opcode::MulK:
+                assembler.emit({0x48, 0x0F, 0xAF, 0xC1}); // imul rax, rcx
+                break;
+            default: {
+                // Division by zero deopts, and so does the one division that traps, leaving both to the interpreter.
+                assembler.emit({0x48, 0x85, 0xC9}); // test rcx, rcx
+                exits.push_back({assembler.jumpIf(JUMP_IF_EQUAL), index, index});
+                assembler.emit({0x48, 0x83, 0xF9, 0xFF}); // cmp rcx, -1
+                size_t divisor_ok = assembler.jumpIf(JUMP_IF_NOT_EQUAL);
+                assembler.emit({0x48, 0xBA}); // mov rdx, INT64_MIN
+                assembler.emit64(uint64_t(1) << 63);
+                assembler.emit({0x48, 0x39, 0xD0}); // cmp rax, rdx
+                exits.push_back({assembler.jumpIf(JUMP_IF_EQUAL), index, index});
+                assembler.patch(divisor_ok, assembler.bytes.size());
+                assembler.emit({0x48, 0x99});       // cqo
+                assembler.emit({0x48, 0xF7, 0xF9}); // idiv rcx
+                if (opcode == Opcode::Mod || opcode == Opcode::ModK) assembler.emit({0x48, 0x89, 0xD0}); // mov rax, rdx
+                break;
+            }
+        }
+        assembler.store(RAX, size);
+        if (keeps_operands) size++;
+        else {
+            assembler.pop(2);
+            size--;
+        }
+    }
+
+    // Only a loop that leaves the queue the size it found it can run from the same layout on every iteration.
+    loop.sizes.push_back(size);
+    if (size != entry_size) return false;
+    loop.length = back_edge - start + 1;
+    if (unconditional) {
+        if (!leaves) return false;
+        // The GOTO after a fused IF* isn't counted by the interpreter, which runs the pair as one instruction.
+        if (fusedWithGoto(program.code[back_edge - 1].opcode)) loop.length--;
+        assembler.emit({0x49, 0xFF, 0xC1}); // inc r9
+        assembler.patch(assembler.jump(), loop_start);
+    } else {
+        if (size < 2) return false;
+        assembler.load(RAX, 0);
+        assembler.load(RCX, 1);
+        assembler.emit({0x49, 0xFF, 0xC1}); // inc r9
+        assembler.emit({0x48, 0x39, 0xC8}); // cmp rax, rcx
+        assembler.patch(assembler.jumpIf(condition), loop_start);
+
+        // The IF* failed: the interpreter carries on after it, or at the GOTO's target when they were fused.
+        size_t exit_index = back_edge + 1;
+        if (fusedWithGoto(closing.opcode)) exit_index = static_cast<size_t>(program.code[back_edge + 1].int_operand);
+        exits.push_back({assembler.jump(), exit_index, start});
+    }
+
+    for (const Exit& exit : exits) {
+        assembler.patch(exit.jump, assembler.bytes.size());
+        assembler.emit({0x4C, 0x89, 0x06});       // mov [rsi], r8
+        assembler.emit({0x4C, 0x89, 0x4E, 0x08}); // mov [rsi + 8], r9
+        assembler.emit({0x48, 0xC7, 0x46, 0x10}); // mov qword [rsi + 16], stop
+        assembler.emit32(static_cast<uint32_t>(exit.stop));
+        assembler.emit({0xB8});                   // mov eax, resume
+        assembler.emit32(static_cast<uint32_t>(exit.resume));
+        assembler.emit({0xC3});                   // ret
+    }
+
+    // Written while writable, then made executable, never both at once.
+    size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t length = (assembler.bytes.size() + page_size - 1) / page_size * page_size;
+    void* memory = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) return false;
+    memcpy(memory, assembler.bytes.data(), assembler.bytes.size());
+    if (mprotect(memory, length, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, length);
+        return false;
+    }
+    mappings.emplace_back(memory, length);
+    loop.code = reinterpret_cast<NativeLoop>(memory);
+    loop.entry_size = entry_size;
+    return true;
+#else
+    (void) back_edge;
+    (void) entry_size;
+    (void) loop;
+    return false;
+#endif
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "../compiler/instruction.h"
+#include "../node/node.h"
+#include "../queue/ringQueue.h"
+
+// Native code is only generated on x86-64 Linux, everywhere else --jit leaves everything to the interpreter.
+#if defined(__x86_64__) && defined(__linux__)
+#define QU_JIT_AVAILABLE 1
+#else
+#define QU_JIT_AVAILABLE 0
+#endif
+
+/**
+ * The optional native tier behind --jit.
+ *
+ * The interpreters report every backward jump they take. Once a loop has gone round often enough, and its body is nothing but
+ * integer pushes, arithmetic and IF*s jumping out of it, closed by an IF* or a GOTO back to its start, the loop is compiled to
+ * x86-64 code. The compiled loop works on the integers of the queue unboxed in a small ring of its own, which is copied in from
+ * the queue when the loop is entered and written back when it leaves. It leaves when its closing IF* fails, when an IF* in its
+ * body jumps out, or by deoptimizing: before any operation that would fail in the interpreter (a division by zero, say) it stops,
+ * writes the queue back as it was before that operation, and the interpreter carries on from there and reports the error at
+ * the right line.
+ */
+class JitEngine {
+private:
+    static constexpr uint32_t HOT_THRESHOLD = 1000; // Backward jumps taken before a loop is compiled.
+    static constexpr size_t RING_SIZE = 64;         // The most elements a compiled loop can have on its queue.
+
+    // Runs a compiled loop: state holds the ring's head, then receives the head, the whole iterations run and the instruction index
+    // the last iteration stopped at (the loop's start when it finished).
+    using NativeLoop = int64_t (*)(int64_t* ring, uint64_t* state);
+
+    struct Loop {
+        uint32_t taken = 0;        // How often the backward jump has been taken.
+        bool rejected = false;     // The loop can't be compiled, so it isn't tried again.
+        size_t entry_size = 0;     // The queue size the code was compiled for.
+        size_t length = 0;         // The instructions the interpreter counts for one iteration.
+        NativeLoop code = nullptr;
+        std::vector<size_t> sizes; // The queue size before each instruction of the loop, from its first to its closing jump.
+    };
+
+    const Program& program;
+    std::vector<Loop> loops;                         // Indexed by the instruction index of each backward jump.
+    std::vector<std::pair<void*, size_t>> mappings;  // Executable memory holding the compiled loops.
+    int64_t ring[RING_SIZE];
+
+    bool compile(size_t back_edge, size_t entry_size, Loop& loop);
+    template <typename T>
+    bool enter(size_t index, RingQueue<T>& program_queue, size_t& resume);
+public:
+    explicit JitEngine(const Program& program);
+    ~JitEngine();
+    JitEngine(const JitEngine&) = delete;
+    JitEngine& operator=(const JitEngine&) = delete;
+
+    static bool available();
+
+    // Ring slots are found by masking, which compiled code does too.
+    static constexpr size_t ringMask() { return RING_SIZE - 1; }
+    bool backEdge(size_t index, RingQueue<node>& program_queue, size_t& resume);
+    bool backEdge(size_t index, RingQueue<int64_t>& program_queue, size_t& resume);
+};
@@ -0,0 +1,105 @@
+#include "runtimeMetrics.h"
+
+#include <cstdio>
+#include "../node/stringArena.h"
+
+using namespace std;
+
+volatile sig_atomic_t RuntimeMetrics::report_requested = 0;
+string RuntimeMetrics::destination;
+thread_local uint64_t RuntimeMetrics::instructions_retired = 0;
+
+/**
+ * Sets where reports go.
+ *
+ * @param path The file to append reports to, or an empty string for stderr.
+ */
+void RuntimeMetrics::setDestination(const string& path) {
+    destination = path;
+}
+
+/**
+ * Makes SIGUSR1 ask for a report, on systems that have it.
+ */
+void RuntimeMetrics::listenForSignal() {
+#ifdef SIGUSR1
+    struct sigaction action = {};
+    action.sa_handler = onSignal;
+    action.sa_flags = SA_RESTART; // A READ waiting for input keeps waiting instead of seeing the end of its input.
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGUSR1, &action, nullptr);
+#endif
+}
+
+void RuntimeMetrics::onSignal(int) {
+    report_requested = 1;
+}
+
+template <typename T>
+void RuntimeMetrics::writeRequested(const RingQueue<T>& program_queue) {
+    report_requested = 0;
+    writeToDestination(program_queue);
+}
+
+/**
+ * Writes a report to wherever reports go.
+ *
+ * @param program_queue The queue for the program itself.
+ */
+template <typename T>
+void RuntimeMetrics::writeToDestination(const RingQueue<T>& program_queue) {
+    FILE* file = destination.empty() ? stderr : fopen(destination.c_str(), "a");
+    if (file == nullptr) return;
+    {
+        OutputSink out(file);
+        write(out, program_queue);
+        out.endLine();
+    }
+    if (file != stderr) fclose(file);
+}
+
+/**
+ * Writes the metrics as a JSON object, in the same form as a node's display.
+ *
+ * @param out Where to write the metrics.
+ * @param program_queue The queue for the program itself.
+ */
+template <typename T>
+void RuntimeMetrics::write(OutputSink& out, const RingQueue<T>& program_queue) {
+    const node::MemoryStats& memory = node::memoryStats();
+    const StringArena::Stats& arena = StringArena::threadStats();
+    const pair<const char*, uint64_t> values[] = {
+        {"instructionsRetired", instructions_retired},
+        {"queueDepth", program_queue.size()},
+        {"peakQueueDepth", program_queue.peakSize()},
+        {"queueCapacity", program_queue.capacity()},
+        {"queueResizes", program_queue.resizeCount()},
+        {"queueCopies", RingQueue<T>::copies()},
+        {"heapStringAllocations", memory.heap_string_allocations},
+        {"liveHeapStrings", memory.live_heap_strings},
+        {"stringBytes", memory.string_bytes},
+        {"peakStringBytes", memory.peak_string_bytes},
+        {"stringMallocs", memory.malloc_allocations},
+        {"arenaAllocations", arena.allocations},
+        {"arenaReuses", arena.reuses},
+        {"arenaLargeAllocations", arena.large_allocations},
+        {"arenaChunks", arena.chunks},
+        {"arenaResets", arena.resets},
+    };
+
+    out.write("{");
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        out.write(i == 0 ? "\n\t\"" : ",\n\t\"");
+        out.write(values[i].first);
+        out.write("\": ");
+        out.writeInt(static_cast<int64_t>(values[i].second));
+    }
+    out.write("\n}");
+}
+
+template void RuntimeMetrics::writeRequested(const RingQueue<node>&);
+template void RuntimeMetrics::writeRequested(const RingQueue<int64_t>&);
+template void RuntimeMetrics::writeToDestination(const RingQueue<node>&);
+template void RuntimeMetrics::writeToDestination(const RingQueue<int64_t>&);
+template void RuntimeMetrics::write(OutputSink&, const RingQueue<node>&);
+template void RuntimeMetrics::write(OutputSink&, const RingQueue<int64_t>&);
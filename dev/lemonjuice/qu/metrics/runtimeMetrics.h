@@ -0,0 +1,43 @@
+#pragma once
+
+#include <csignal>
+#include <cstdint>
+#include <string>
+#include "../node/node.h"
+#include "../output/outputSink.h"
+#include "../queue/ringQueue.h"
+
+/**
+ * Counters describing what a running program is doing to the queue and to memory, cheap enough to always be kept.
+ * They are written as JSON when the interpreter exits with --metrics, and whenever the process receives SIGUSR1.
+ * The signal only raises a flag: the report itself is written by the interpreter at its next jump, where it is safe to.
+ */
+class RuntimeMetrics {
+private:
+    static volatile std::sig_atomic_t report_requested;
+    static std::string destination; // The file reports are appended to, stderr when empty.
+
+    static void onSignal(int);
+    template <typename T>
+    static void writeRequested(const RingQueue<T>& program_queue);
+public:
+    static thread_local uint64_t instructions_retired;
+
+    static void setDestination(const std::string& path);
+    static void listenForSignal();
+    // A program runs on a queue of nodes, or of plain integers on the IntExecutor.
+    template <typename T>
+    static void write(OutputSink& out, const RingQueue<T>& program_queue);
+    template <typename T>
+    static void writeToDestination(const RingQueue<T>& program_queue);
+
+    /**
+     * Writes a report if SIGUSR1 asked for one since the last check.
+     *
+     * @param program_queue The queue for the program itself.
+     */
+    template <typename T>
+    static void poll(const RingQueue<T>& program_queue) {
+        if (report_requested) writeRequested(program_queue);
+    }
+};
@@ -1,50 +1,403 @@
 #include "node.h"
 
+#include <algorithm>
+#include <cstring>
+#include <new>
 #include <iostream>
+#include <vector>
+#include "../output/outputSink.h"
+#include "../output/queueWriter.h"
+#include "stringArena.h"
 
 using namespace std;
 
-node::node() : node (0, "", true) {}
+static_assert(sizeof(node) == 16, "A node should fit in 16 bytes.");
 
-node::node(int intValue) : node (intValue, "", true) {}
+thread_local node::MemoryStats node::memory_stats;
 
-node::node(string stringValue) : node (0, stringValue, false) {}
+node::node() : node (int64_t(0)) {}
 
-node::node(int intValue, std::string stringValue, bool isInteger) : intVal(intValue), stringVal(stringValue), isInt(isInteger) {}
+node::node(int64_t intValue) : kind(INT_NODE) {
+    memcpy(storage, &intValue, sizeof(intValue));
+}
+
+node::node(string stringValue) : kind(INT_NODE) {
+    assignString(stringValue);
+}
+
+node::node(int64_t intValue, std::string stringValue, bool isInteger) : kind(INT_NODE) {
+    if (isInteger) memcpy(storage, &intValue, sizeof(intValue));
+    else assignString(stringValue);
+}
+
+node::node(const node& other) : kind(other.kind) {
+    memcpy(storage, other.storage, sizeof(storage));
+    if (kind == HEAP_STRING_NODE) heapData()->references++;
+}
+
+node::node(node&& other) noexcept : kind(other.kind) {
+    memcpy(storage, other.storage, sizeof(storage));
+    other.kind = INT_NODE; // The heap data, if any, now belongs to this node.
+}
+
+node& node::operator=(const node& other) {
+    if (this != &other) {
+        if (other.kind == HEAP_STRING_NODE) other.heapData()->references++;
+        release();
+        memcpy(storage, other.storage, sizeof(storage));
+        kind = other.kind;
+    }
+    return *this;
+}
+
+node& node::operator=(node&& other) noexcept {
+    if (this != &other) {
+        release();
+        memcpy(storage, other.storage, sizeof(storage));
+        kind = other.kind;
+        other.kind = INT_NODE;
+    }
+    return *this;
+}
+
+node::~node() {
+    release();
+}
+
+/**
+ * Gets the shared heap data of a long string node.
+ * 
+ * @return The heap data.
+ */
+node::StringData* node::heapData() const {
+    StringData* data;
+    memcpy(&data, storage, sizeof(data));
+    return data;
+}
+
+/**
+ * Makes this node hold a string, inline if it is short enough.
+ * Any string this node held before must already have been released.
+ * 
+ * @param stringValue The string.
+ */
+void node::assignString(std::string_view stringValue) {
+    if (stringValue.size() <= INLINE_CAPACITY) {
+        memcpy(storage, stringValue.data(), stringValue.size());
+        storage[INLINE_CAPACITY] = static_cast<unsigned char>(stringValue.size());
+        kind = INLINE_STRING_NODE;
+    } else {
+        StringData* data = newData(stringValue.size(), nullptr, nullptr, stringValue);
+        memcpy(storage, &data, sizeof(data));
+        kind = HEAP_STRING_NODE;
+    }
+}
+
+/**
+ * Gets heap data holding this node's string, adding a reference to it for the caller.
+ * 
+ * @return The heap data, newly made if the string was stored inline.
+ */
+node::StringData* node::shareData() const {
+    if (kind == HEAP_STRING_NODE) {
+        heapData()->references++;
+        return heapData();
+    }
+    std::string_view text = stringView();
+    return newData(text.size(), nullptr, nullptr, text);
+}
+
+/**
+ * Makes new heap data with a single reference, counting it in the memory stats.
+ * 
+ * @param length The length of the whole string.
+ * @param left The first piece of a rope, or null for a flat string.
+ * @param right The second piece of a rope, or null for a flat string.
+ * @param text The characters of a flat string, empty for a rope.
+ * @return The heap data.
+ */
+node::StringData* node::newData(size_t length, StringData* left, StringData* right, std::string_view text) {
+    memory_stats.heap_string_allocations++;
+    memory_stats.live_heap_strings++;
+    addStringBytes(text.size());
+    StringArena* arena = StringArena::active();
+    StringData* data = new (allocateBlock(arena, sizeof(StringData))) StringData{1, length, 0, left, right, arena, nullptr};
+    if (left == nullptr) {
+        data->capacity = text.size();
+        data->chars = static_cast<char*>(allocateBlock(arena, data->capacity));
+        memcpy(data->chars, text.data(), text.size());
+    }
+    return data;
+}
+
+/**
+ * Allocates a block for a heap string.
+ * 
+ * @param arena The arena to allocate from, or null for the heap.
+ * @param size The size of the block.
+ * @return The block.
+ */
+void* node::allocateBlock(StringArena* arena, size_t size) {
+    if (arena != nullptr) return arena->allocate(size);
+    memory_stats.malloc_allocations++;
+    return ::operator new(size);
+}
+
+/**
+ * Frees a block allocated by allocateBlock.
+ * 
+ * @param arena The arena it was allocated from, or null for the heap.
+ * @param block The block.
+ * @param size The size it was allocated with.
+ */
+void node::freeBlock(StringArena* arena, void* block, size_t size) {
+    if (arena != nullptr) arena->deallocate(block, size);
+    else ::operator delete(block);
+}
+
+/**
+ * Counts characters newly held by heap strings.
+ * 
+ * @param bytes The number of characters.
+ */
+void node::addStringBytes(size_t bytes) {
+    memory_stats.string_bytes += bytes;
+    if (memory_stats.string_bytes > memory_stats.peak_string_bytes) memory_stats.peak_string_bytes = memory_stats.string_bytes;
+}
+
+/**
+ * Gets what the heap strings of the current thread are using.
+ * 
+ * @return The stats.
+ */
+const node::MemoryStats& node::memoryStats() {
+    return memory_stats;
+}
+
+/**
+ * Drops this node's reference to its heap data, freeing it if this was the last one.
+ */
+void node::release() {
+    if (kind != HEAP_STRING_NODE) return;
+    releaseData(heapData());
+    kind = INT_NODE;
+}
+
+/**
+ * Joins the pieces of a rope into its own text, and lets go of the pieces.
+ * 
+ * @param data The heap data to flatten.
+ */
+void node::flatten(StringData* data) {
+    if (data->left == nullptr) return;
+
+    // Walk the pieces in order without recursing, ropes built by repeated ADDs are as deep as they are long.
+    char* chars = static_cast<char*>(allocateBlock(data->arena, data->length));
+    size_t used = 0;
+    std::vector<const StringData*> pending = {data->right, data->left};
+    while (!pending.empty()) {
+        const StringData* piece = pending.back();
+        pending.pop_back();
+        if (piece->left == nullptr) {
+            memcpy(chars + used, piece->chars, piece->length);
+            used += piece->length;
+        }
+        else {
+            pending.push_back(piece->right);
+            pending.push_back(piece->left);
+        }
+    }
+
+    data->chars = chars;
+    data->capacity = data->length;
+    addStringBytes(data->length);
+    releaseData(data->left);
+    releaseData(data->right);
+    data->left = nullptr;
+    data->right = nullptr;
+}
+
+/**
+ * Drops a reference to heap data, freeing it and every piece only it referenced once nothing refers to it.
+ * 
+ * @param data The heap data.
+ */
+void node::releaseData(StringData* data) {
+    std::vector<StringData*> pending; // Right pieces still to release, so freeing a deep rope doesn't recurse.
+    while (data != nullptr) {
+        StringData* next = nullptr;
+        if (--data->references == 0) {
+            if (data->left != nullptr) {
+                next = data->left;
+                pending.push_back(data->right);
+            }
+            memory_stats.live_heap_strings--;
+            if (data->chars != nullptr) {
+                memory_stats.string_bytes -= data->length;
+                freeBlock(data->arena, data->chars, data->capacity);
+            }
+            freeBlock(data->arena, data, sizeof(StringData));
+        }
+        if (next == nullptr && !pending.empty()) {
+            next = pending.back();
+            pending.pop_back();
+        }
+        data = next;
+    }
+}
 
 bool node::containsInt() const {
-    return isInt;
+    return kind == INT_NODE;
 }
 
 bool node::containsString() const {
-    return !isInt;
+    return kind != INT_NODE;
 }
 
-int node::getInt() const {
-    return intVal;
+int64_t node::getInt() const {
+    if (kind != INT_NODE) return 0;
+    int64_t intValue;
+    memcpy(&intValue, storage, sizeof(intValue));
+    return intValue;
 }
 
 std::string node::getIntAsString() const {
-    return std::to_string(intVal);
+    return std::to_string(getInt());
 }
 
 std::string node::getString() const {
-    return stringVal;
+    return std::string(stringView());
+}
+
+/**
+ * Gets the string of a node without copying it.
+ * The view is only valid while the node is alive and unchanged.
+ * 
+ * @return The string, or an empty string for an integer node.
+ */
+std::string_view node::stringView() const {
+    if (kind == INLINE_STRING_NODE) return std::string_view(reinterpret_cast<const char*>(storage), storage[INLINE_CAPACITY]);
+    if (kind == HEAP_STRING_NODE) {
+        StringData* data = heapData();
+        flatten(data);
+        return std::string_view(data->chars, data->length);
+    }
+    return std::string_view();
 }
 
-void node::setInt(int intValue) {
-    intVal = intValue;
+/**
+ * Gets the length of the string of a node, without flattening it.
+ * 
+ * @return The length of the string, or 0 for an integer node.
+ */
+size_t node::stringLength() const {
+    if (kind == INLINE_STRING_NODE) return storage[INLINE_CAPACITY];
+    if (kind == HEAP_STRING_NODE) return heapData()->length;
+    return 0;
+}
+
+/**
+ * Appends the string of another node to the string of this node, making this a string node.
+ * A heap string only this node holds is extended in place, otherwise the two strings are shared as a rope, so this never copies a long string.
+ * 
+ * @param other The node whose string comes second.
+ */
+void node::append(const node& other) {
+    size_t length = stringLength() + other.stringLength();
+
+    // Short results stay inline
+    if (length <= INLINE_CAPACITY) {
+        char text[INLINE_CAPACITY];
+        std::string_view first = stringView();
+        std::string_view second = other.stringView();
+        // An integer or an empty string has no characters, and its null data() mustn't reach memcpy.
+        if (!first.empty()) memcpy(text, first.data(), first.size());
+        if (!second.empty()) memcpy(text + first.size(), second.data(), second.size());
+        release();
+        assignString(std::string_view(text, length));
+        return;
+    }
+
+    // Appending nothing, or to nothing, is just a copy
+    if (other.stringLength() == 0) return;
+    if (stringLength() == 0) {
+        *this = other;
+        return;
+    }
+
+    StringData* data = kind == HEAP_STRING_NODE ? heapData() : nullptr;
+    if (data != nullptr && data->references == 1 && data->left == nullptr) {
+        std::string_view appended = other.stringView();
+        if (length > data->capacity) {
+            // Grow the way std::string does, so repeated appends in place copy each character only a few times.
+            size_t capacity = std::max(length, data->capacity * 2);
+            char* chars = static_cast<char*>(allocateBlock(data->arena, capacity));
+            memcpy(chars, data->chars, data->length);
+            freeBlock(data->arena, data->chars, data->capacity);
+            data->chars = chars;
+            data->capacity = capacity;
+        }
+        memcpy(data->chars + data->length, appended.data(), appended.size());
+        data->length = length;
+        addStringBytes(appended.size());
+        return;
+    }
+
+    StringData* left = shareData();
+    StringData* right = other.shareData();
+    release();
+    StringData* joined = newData(length, left, right, std::string_view());
+    memcpy(storage, &joined, sizeof(joined));
+    kind = HEAP_STRING_NODE;
+}
+
+/**
+ * Orders this node against another.
+ * Integers compare by value and strings compare by their characters, every integer comes before every string.
+ * 
+ * @param other The node to compare against.
+ * @return A negative number, zero or a positive number when this node is less than, equal to or greater than the other.
+ */
+int node::compare(const node& other) const {
+    if (containsInt() && other.containsInt()) {
+        int64_t first = getInt();
+        int64_t second = other.getInt();
+        return (first > second) - (first < second);
+    }
+    if (containsInt() != other.containsInt()) return containsInt() ? -1 : 1;
+    int order = stringView().compare(other.stringView());
+    return (order > 0) - (order < 0);
+}
+
+void node::setInt(int64_t intValue) {
+    release();
+    memcpy(storage, &intValue, sizeof(intValue));
+    kind = INT_NODE;
 }
 
 void node::setString(std::string stringValue) {
-    stringVal = stringValue;
+    release();
+    assignString(stringValue);
 }
 
 void node::p_print() const {
     if (containsInt()) {
         std::cout << getInt();
     } else {
-        std::cout << getString();
+        std::cout << stringView();
+    }
+}
+
+/**
+ * Prints the value of a node, as it is shown by PEEK and POP.
+ * 
+ * @param out Where to print the value.
+ */
+void node::p_print(OutputSink& out) const {
+    if (containsInt()) {
+        out.writeInt(getInt());
+    } else {
+        out.write(stringView());
     }
 }
 
@@ -53,6 +406,16 @@ void node::p_println() const {
     std::cout << std::endl;
 }
 
+/**
+ * Prints the value of a node on a line of its own.
+ * 
+ * @param out Where to print the value.
+ */
+void node::p_println(OutputSink& out) const {
+    p_print(out);
+    out.endLine();
+}
+
 /**
  * Creates the display of a node in a human-readable form.
  * This creates a psuedo-json form of the node.
@@ -60,21 +423,39 @@ void node::p_println() const {
  * @return The human-readable display of a node.
  */
 std::string node::createNodeDisplay() const {
-    std::string node = "";
-    node += "{\n";
-    node += "\t\"nodeType\": ";
+    std::string display;
+    {
+        OutputSink out(display);
+        writeNodeDisplay(out, false);
+    }
+    return display;
+}
+
+/**
+ * Writes the display of a node straight to an output, as a JSON object.
+ * 
+ * @param out Where to write the display.
+ * @param compact true to write the display on one line, false to spread it over several lines.
+ */
+void node::writeNodeDisplay(OutputSink& out, bool compact) const {
+    const char* separator = compact ? ", " : ",\n\t";
+    out.write(compact ? "{" : "{\n\t");
+    out.write("\"nodeType\": ");
 
     if(containsInt()) {
-        node += "\"int\",\n";
-        node += "\t\"nodeValue\": " + std::to_string(getInt()) + "\n";
+        out.write("\"int\"");
+        out.write(separator);
+        out.write("\"nodeValue\": ");
+        out.writeInt(getInt());
     }
     else {
-        node += "\"string\",\n";
-        node += "\t\"nodeValue\": \"" + getString() + "\"\n";
+        out.write("\"string\"");
+        out.write(separator);
+        out.write("\"nodeValue\": ");
+        QueueWriter::writeJsonString(out, stringView());
     }
 
-    node += "}";
-    return node;
+    out.write(compact ? "}" : "\n}");
 }
 
 /**
@@ -1,27 +1,89 @@
-#pragma once 
+#pragma once
+#include <cstdint>
 #include <string>
+#include <string_view>
 
+class OutputSink;
+class StringArena;
+
+/**
+ * A single value on the queue, either a 64-bit integer or a string, packed into 16 bytes.
+ * Strings of up to INLINE_CAPACITY characters are stored inside the node itself, longer strings are shared, reference counted heap data.
+ * Heap strings are ropes: appending to a string only links the two pieces together, and the characters are joined the first time they are looked at.
+ * Heap strings are allocated from the StringArena active when they are made, or from the heap when there isn't one.
+ */
 class node{
+public:
+    /**
+     * What the heap strings of the current thread are using, for the runtime metrics.
+     */
+    struct MemoryStats {
+        uint64_t heap_string_allocations = 0; // Every StringData ever made, pieces of ropes included.
+        uint64_t live_heap_strings = 0;
+        uint64_t string_bytes = 0;            // Characters held by live heap strings.
+        uint64_t peak_string_bytes = 0;
+        uint64_t malloc_allocations = 0;      // Blocks of heap strings made outside any arena, each its own malloc.
+    };
 private:
-    int intVal;
-    std::string stringVal;
-    bool isInt;
+    static constexpr size_t INLINE_CAPACITY = 14;
+    enum : unsigned char { INT_NODE, INLINE_STRING_NODE, HEAP_STRING_NODE };
+
+    struct StringData {
+        size_t references;
+        size_t length;
+        size_t capacity;    // The size of the chars block, 0 while there isn't one.
+        StringData* left;   // When not null, the string is left followed by right and chars is null until it is flattened.
+        StringData* right;
+        StringArena* arena; // Where this and its chars came from, null for the heap.
+        char* chars;
+    };
+
+    // Holds the integer, the StringData pointer, or the inline characters followed by their length.
+    alignas(8) unsigned char storage[15];
+    unsigned char kind;
+
+    StringData* heapData() const;
+    StringData* shareData() const;
+    void assignString(std::string_view);
+    void release();
+    static void flatten(StringData*);
+    static void releaseData(StringData*);
+    static StringData* newData(size_t, StringData*, StringData*, std::string_view);
+    static void addStringBytes(size_t);
+    static void* allocateBlock(StringArena*, size_t);
+    static void freeBlock(StringArena*, void*, size_t);
+
+    static thread_local MemoryStats memory_stats;
 public:
     node();
-    node(int);
+    node(int64_t);
     node(std::string);
-    node(int, std::string, bool);
-
-    bool containsInt() const;        
-    bool containsString() const;     
-    int getInt() const;              
-    std::string getIntAsString() const;  
-    std::string getString() const;   
-    void setInt(int);
+    node(int64_t, std::string, bool);
+    node(const node&);
+    node(node&&) noexcept;
+    node& operator=(const node&);
+    node& operator=(node&&) noexcept;
+    ~node();
+
+    bool containsInt() const;
+    bool containsString() const;
+    int64_t getInt() const;
+    std::string getIntAsString() const;
+    std::string getString() const;
+    std::string_view stringView() const;
+    size_t stringLength() const;
+    void append(const node&);
+    int compare(const node&) const;
+    void setInt(int64_t);
     void setString(std::string);
-    void p_print() const;         
-    void p_println() const; 
+    void p_print() const;
+    void p_print(OutputSink&) const;
+    void p_println() const;
+    void p_println(OutputSink&) const;
 
     std::string createNodeDisplay() const;
-    void printNode() const; 
-};
\ No newline at end of file
+    void writeNodeDisplay(OutputSink&, bool) const;
+    void printNode() const;
+
+    static const MemoryStats& memoryStats();
+};
@@ -0,0 +1,122 @@
+#include "stringArena.h"
+
+#include <new>
+
+using namespace std;
+
+thread_local StringArena* StringArena::active_arena = nullptr;
+thread_local StringArena::Stats StringArena::stats;
+
+StringArena::Scope::Scope(StringArena& arena) : previous(active_arena) {
+    active_arena = &arena;
+}
+
+StringArena::Scope::~Scope() {
+    active_arena = previous;
+}
+
+/**
+ * Gives the chunks back to the heap. Every string made from the arena must already be gone.
+ */
+StringArena::~StringArena() {
+    for (char* chunk : chunks) ::operator delete(chunk);
+}
+
+/**
+ * Cuts a new block from the chunks, moving on to the next chunk (or taking a new one) when the current one is used up.
+ *
+ * @param size The size of the block, a multiple of GRANULE no bigger than LARGEST_POOLED.
+ * @return The block.
+ */
+void* StringArena::cut(size_t size) {
+    if (static_cast<size_t>(end - next) < size) {
+        if (next != nullptr) chunk_index++;
+        if (chunk_index == chunks.size()) {
+            chunks.push_back(static_cast<char*>(::operator new(CHUNK_SIZE)));
+            stats.chunks++;
+        }
+        next = chunks[chunk_index];
+        end = next + CHUNK_SIZE;
+    }
+    void* block = next;
+    next += size;
+    return block;
+}
+
+/**
+ * Allocates a block.
+ *
+ * @param size The size of the block, in bytes.
+ * @return The block, aligned for anything a string needs.
+ */
+void* StringArena::allocate(size_t size) {
+    stats.allocations++;
+    live++;
+    if (size > LARGEST_POOLED) {
+        stats.large_allocations++;
+        return ::operator new(size);
+    }
+
+    size_t granules = size == 0 ? 1 : (size + GRANULE - 1) / GRANULE;
+    FreeBlock*& free_list = free_lists[granules - 1];
+    if (free_list != nullptr) {
+        stats.reuses++;
+        FreeBlock* block = free_list;
+        free_list = block->next;
+        return block;
+    }
+    return cut(granules * GRANULE);
+}
+
+/**
+ * Frees a block, which goes on the free list for its size.
+ *
+ * @param block The block, from this arena.
+ * @param size The size it was allocated with.
+ */
+void StringArena::deallocate(void* block, size_t size) {
+    live--;
+    if (size > LARGEST_POOLED) {
+        ::operator delete(block);
+        return;
+    }
+
+    size_t granules = size == 0 ? 1 : (size + GRANULE - 1) / GRANULE;
+    FreeBlock* freed = static_cast<FreeBlock*>(block);
+    freed->next = free_lists[granules - 1];
+    free_lists[granules - 1] = freed;
+}
+
+/**
+ * Rewinds the arena to the start of its first chunk, if nothing allocated from it is alive.
+ * The chunks are kept, so the next run cuts its blocks from memory that is already there.
+ *
+ * @return true if the arena was rewound.
+ */
+bool StringArena::reset() {
+    if (live != 0) return false;
+    for (FreeBlock*& free_list : free_lists) free_list = nullptr;
+    chunk_index = 0;
+    next = nullptr;
+    end = nullptr;
+    stats.resets++;
+    return true;
+}
+
+/**
+ * Gets the arena strings made on the current thread come from.
+ *
+ * @return The arena, or null if strings come from the heap.
+ */
+StringArena* StringArena::active() {
+    return active_arena;
+}
+
+/**
+ * Gets what the arenas of the current thread have done.
+ *
+ * @return The stats.
+ */
+const StringArena::Stats& StringArena::threadStats() {
+    return stats;
+}
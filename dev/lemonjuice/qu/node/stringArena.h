@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Where the long strings of a run are allocated, instead of each one going to the heap on its own.
+ *
+ * Blocks are cut from large chunks one after another, and a freed block goes on a free list for its size to be handed out
+ * again. Once nothing allocated from the arena is alive, reset rewinds it to the start of its first chunk, so a run that
+ * starts from an empty queue reuses the memory of the run before it. Blocks too big to pool go straight to the heap.
+ *
+ * An arena is made active for a thread with a Scope, and strings made on that thread while it is active come from it.
+ * An arena isn't thread safe: its strings must only be made and freed by the thread using it at the time.
+ */
+class StringArena {
+public:
+    /**
+     * What the arenas of the current thread have done, for the runtime metrics.
+     */
+    struct Stats {
+        uint64_t allocations = 0;       // Every block handed out, reused ones included.
+        uint64_t reuses = 0;            // Blocks handed out again from a free list.
+        uint64_t large_allocations = 0; // Blocks too big to pool, which came from the heap.
+        uint64_t chunks = 0;            // Chunks taken from the heap.
+        uint64_t resets = 0;
+    };
+
+    /**
+     * Makes an arena the active one for the current thread while it exists, putting back the one before it afterwards.
+     */
+    class Scope {
+    private:
+        StringArena* previous;
+    public:
+        explicit Scope(StringArena& arena);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+private:
+    static constexpr size_t CHUNK_SIZE = 1 << 16;
+    static constexpr size_t GRANULE = 16;          // Every pooled block is a multiple of this.
+    static constexpr size_t LARGEST_POOLED = 1024; // Bigger blocks come from the heap.
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    std::vector<char*> chunks;
+    size_t chunk_index = 0; // The chunk blocks are being cut from.
+    char* next = nullptr;   // The rest of that chunk.
+    char* end = nullptr;
+    FreeBlock* free_lists[LARGEST_POOLED / GRANULE] = {}; // Indexed by size in granules, less one.
+    uint64_t live = 0;      // Blocks handed out and not yet freed.
+
+    static thread_local StringArena* active_arena;
+    static thread_local Stats stats;
+
+    void* cut(size_t size);
+public:
+    StringArena() = default;
+    ~StringArena();
+    StringArena(const StringArena&) = delete;
+    StringArena& operator=(const StringArena&) = delete;
+
+    void* allocate(size_t size);
+    void deallocate(void* block, size_t size);
+    bool reset();
+
+    static StringArena* active();
+    static const Stats& threadStats();
+};
@@ -1,4 +1,5 @@
 #include <string>
+#include <utility>
 #include "operationHandler.h"
 
 using namespace std;
@@ -9,27 +10,30 @@ using namespace std;
  * @param program_queue The queue for the program itself.
  * @param line_number The current line index in the program.
  * @param error_handler The interpreter's error handler.
+ * @return true if it succeeded, false if it reported an error.
  */
-void OperationHandler::quAdd(std::queue<node>& program_queue, int line_number, errorHandler error_handler) {
-    if (program_queue.size() < 2) {
+bool OperationHandler::quAdd(RingQueue<node>& program_queue, int line_number, errorHandler& error_handler) {
+    if (QU_UNLIKELY(program_queue.size() < 2)) {
         // Ensure that there are at least two elements in the queue
         error_handler.notEnoughArguments(line_number);
+        return false;
     }
 
-    node first_operand = program_queue.front();
+    node first_operand = std::move(program_queue.front());
     program_queue.pop();
-    node second_operand = program_queue.front();
+    node second_operand = std::move(program_queue.front());
     program_queue.pop();
 
     if (first_operand.containsInt() && second_operand.containsInt()) {
         // Both operands are integers, perform integer addition
-        int result = first_operand.getInt() + second_operand.getInt();
+        int64_t result = first_operand.getInt() + second_operand.getInt();
         program_queue.push(node(result));
     } else {
         // At least one operand is not an integer, concatenate string representations
-        string result_str = first_operand.getString() + second_operand.getString();
-        program_queue.push(node(result_str));
+        first_operand.append(second_operand);
+        program_queue.push(std::move(first_operand));
     }
+    return true;
 }
 
 /**
@@ -38,39 +42,30 @@ void OperationHandler::quAdd(std::queue<node>& program_queue, int line_number, e
  * @param program_queue The queue for the program itself.
  * @param line_number The current line index in the program.
  * @param error_handler The interpreter's error handler.
+ * @return true if it succeeded, false if it reported an error.
  */
-void OperationHandler::quAddK(std::queue<node>& program_queue, int line_number, errorHandler error_handler) {
-    if (program_queue.size() < 2) {
+bool OperationHandler::quAddK(RingQueue<node>& program_queue, int line_number, errorHandler& error_handler) {
+    if (QU_UNLIKELY(program_queue.size() < 2)) {
         // Ensure that there are at least two elements in the queue
         error_handler.notEnoughArguments(line_number);
+        return false;
     }
 
-    node first_operand = program_queue.front();
-    program_queue.pop();
-    node second_operand = program_queue.front();
+    // The first operand is kept at the front of the queue, so only look at the operands.
+    const node& first_operand = program_queue.peek(0);
+    const node& second_operand = program_queue.peek(1);
 
     if (first_operand.containsInt() && second_operand.containsInt()) {
         // Both operands are integers, perform integer addition
-        int result = first_operand.getInt() + second_operand.getInt();
+        int64_t result = first_operand.getInt() + second_operand.getInt();
         program_queue.push(node(result));
     } else {
         // At least one operand is not an integer, concatenate string representations
-        string result_str = first_operand.getString() + second_operand.getString();
-        program_queue.push(node(result_str));
+        node result = first_operand;
+        result.append(second_operand);
+        program_queue.push(std::move(result));
     }
-
-    // Create a new queue and add the first operand to it
-    std::queue<node> new_queue;
-    new_queue.push(first_operand);
-
-    // Add the rest of the original queue to the new queue
-    while (!program_queue.empty()) {
-        new_queue.push(program_queue.front());
-        program_queue.pop();
-    }
-
-    // Replace the original queue with the new queue
-    program_queue = new_queue;
+    return true;
 }
 
 /**
@@ -79,11 +74,13 @@ void OperationHandler::quAddK(std::queue<node>& program_queue, int line_number,
  * @param program_queue The queue for the program itself.
  * @param line_number The current line index in the program.
  * @param error_handler The interpreter's error handler.
+ * @return true if it succeeded, false if it reported an error.
  */
-void OperationHandler::quSub(std::queue<node>& program_queue, int line_number, errorHandler error_handler) {
-    if (program_queue.size() < 2) {
+bool OperationHandler::quSub(RingQueue<node>& program_queue, int line_number, errorHandler& error_handler) {
+    if (QU_UNLIKELY(program_queue.size() < 2)) {
         // Ensure that there are at least two elements in the queue
         error_handler.notEnoughArguments(line_number);
+        return false;
     }
 
     node first_operand = program_queue.front();
@@ -93,12 +90,14 @@ void OperationHandler::quSub(std::queue<node>& program_queue, int line_number, e
 
     if (first_operand.containsInt() && second_operand.containsInt()) {
         // Both operands are integers, perform integer subtraction
-        int result = first_operand.getInt() - second_operand.getInt();
+        int64_t result = first_operand.getInt() - second_operand.getInt();
         program_queue.push(node(result));
     } else {
         // Error: SUB operation is only defined for integer operands
         error_handler.operationMismatch(line_number);
+        return false;
     }
+    return true;
 }
 
 /**
@@ -107,38 +106,29 @@ void OperationHandler::quSub(std::queue<node>& program_queue, int line_number, e
  * @param program_queue The queue for the program itself.
  * @param line_number The current line index in the program.
  * @param error_handler The interpreter's error handler.
+ * @return true if it succeeded, false if it reported an error.
  */
-void OperationHandler::quSubK(std::queue<node>& program_queue, int line_number, errorHandler error_handler) {
-    if (program_queue.size() < 2) {
+bool OperationHandler::quSubK(RingQueue<node>& program_queue, int line_number, errorHandler& error_handler) {
+    if (QU_UNLIKELY(program_queue.size() < 2)) {
         // Ensure that there are at least two elements in the queue
         error_handler.notEnoughArguments(line_number);
+        return false;
     }
 
-    node first_operand = program_queue.front();
-    program_queue.pop();
-    node second_operand = program_queue.front();
+    // The first operand is kept at the front of the queue, so only look at the operands.
+    const node& first_operand = program_queue.peek(0);
+    const node& second_operand = program_queue.peek(1);
 
     if (first_operand.containsInt() && second_operand.containsInt()) {
         // Both operands are integers, perform integer subtraction
-        int result = first_operand.getInt() - second_operand.getInt();
+        int64_t result = first_operand.getInt() - second_operand.getInt();
         program_queue.push(node(result));
     } else {
         // Error: SUB operation is only defined for integer operands
         error_handler.operationMismatch(line_number);
+        return false;
     }
-
-    // Create a new queue and add the first operand to it
-    std::queue<node> new_queue;
-    new_queue.push(first_operand);
-
-    // Add the rest of the original queue to the new queue
-    while (!program_queue.empty()) {
-        new_queue.push(program_queue.front());
-        program_queue.pop();
-    }
-
-    // Replace the original queue with the new queue
-    program_queue = new_queue;
+    return true;
 }
 
 /**
@@ -147,11 +137,13 @@ void OperationHandler::quSubK(std::queue<node>& program_queue, int line_number,
  * @param program_queue The queue for the program itself.
  * @param line_number The current line index in the program.
  * @param error_handler The interpreter's error handler.
+ * @return true if it succeeded, false if it reported an error.
  */
-void OperationHandler::quMul(std::queue<node>& program_queue, int line_number, errorHandler error_handler) {
-    if (program_queue.size() < 2) {
+bool OperationHandler::quMul(RingQueue<node>& program_queue, int line_number, errorHandler& error_handler) {
+    if (QU_UNLIKELY(program_queue.size() < 2)) {
         // Ensure that there are at least two elements in the queue
         error_handler.notEnoughArguments(line_number);
+        return false;
     }
 
     node first_operand = program_queue.front();
@@ -161,12 +153,14 @@ void OperationHandler::quMul(std::queue<node>& program_queue, int line_number, e
 
     if (first_operand.containsInt() && second_operand.containsInt()) {
         // Both operands are integers, perform integer multiplication
-        int result = first_operand.getInt() * second_operand.getInt();
+        int64_t result = first_operand.getInt() * second_operand.getInt();
         program_queue.push(node(result));
     } else {
         // Error: MUL operation is only defined for integer operands
         error_handler.operationMismatch(line_number);
+        return false;
     }
+    return true;
 }
 
 /**
@@ -175,38 +169,29 @@ void OperationHandler::quMul(std::queue<node>& program_queue, int line_number, e
  * @param program_queue The queue for the program itself.
  * @param line_number The current line index in the program.
  * @param error_handler The interpreter's error handler.
+ * @return true if it succeeded, false if it reported an error.
  */
-void OperationHandler::quMulK(std::queue<node>& program_queue, int line_number, errorHandler error_handler) {
-    if (program_queue.size() < 2) {
+bool OperationHandler::quMulK(RingQueue<node>& program_queue, int line_number, errorHandler& error_handler) {
+    if (QU_UNLIKELY(program_queue.size() < 2)) {
         // Ensure that there are at least two elements in the queue
         error_handler.notEnoughArguments(line_number);
+        return false;
     }
 
-    node first_operand = program_queue.front();
-    program_queue.pop();
-    node second_operand = program_queue.front();
+    // The first operand is kept at the front of the queue, so only look at the operands.
+    const node& first_operand = program_queue.peek(0);
+    const node& second_operand = program_queue.peek(1);
 
     if (first_operand.containsInt() && second_operand.containsInt()) {
         // Both operands are integers, perform integer multiplication
-        int result = first_operand.getInt() * second_operand.getInt();
+        int64_t result = first_operand.getInt() * second_operand.getInt();
         program_queue.push(node(result));
     } else {
         // Error: MUL operation is only defined for integer operands
         error_handler.operationMismatch(line_number);
+        return false;
     }
-
-    // Create a new queue and add the first operand to it
-    std::queue<node> new_queue;
-    new_queue.push(first_operand);
-
-    // Add the rest of the original queue to the new queue
-    while (!program_queue.empty()) {
-        new_queue.push(program_queue.front());
-        program_queue.pop();
-    }
-
-    // Replace the original queue with the new queue
-    program_queue = new_queue;
+    return true;
 }
 
 /**
@@ -215,11 +200,13 @@ void OperationHandler::quMulK(std::queue<node>& program_queue, int line_number,
  * @param program_queue The queue for the program itself.
  * @param line_number The current line index in the program.
  * @param error_handler The interpreter's error handler.
+ * @return true if it succeeded, false if it reported an error.
  */
-void OperationHandler::quDiv(std::queue<node>& program_queue, int line_number, errorHandler error_handler) {
-    if (program_queue.size() < 2) {
+bool OperationHandler::quDiv(RingQueue<node>& program_queue, int line_number, errorHandler& error_handler) {
+    if (QU_UNLIKELY(program_queue.size() < 2)) {
         // Ensure that there are at least two elements in the queue
         error_handler.notEnoughArguments(line_number);
+        return false;
     }
 
     node first_operand = program_queue.front();
@@ -229,17 +216,20 @@ void OperationHandler::quDiv(std::queue<node>& program_queue, int line_number, e
 
     if (first_operand.containsInt() && second_operand.containsInt()) {
         // Check for division by zero
-        if (second_operand.getInt() == 0) {
+        if (QU_UNLIKELY(second_operand.getInt() == 0)) {
             error_handler.divisionByZero(line_number);
+            return false;
         }
 
         // Both operands are integers, perform integer division
-        int result = first_operand.getInt() / second_operand.getInt();
+        int64_t result = first_operand.getInt() / second_operand.getInt();
         program_queue.push(node(result));
     } else {
         // Error: DIV operation is only defined for integer operands
         error_handler.operationMismatch(line_number);
+        return false;
     }
+    return true;
 }
 
 /**
@@ -248,43 +238,35 @@ void OperationHandler::quDiv(std::queue<node>& program_queue, int line_number, e
  * @param program_queue The queue for the program itself.
  * @param line_number The current line index in the program.
  * @param error_handler The interpreter's error handler.
+ * @return true if it succeeded, false if it reported an error.
  */
-void OperationHandler::quDivK(std::queue<node>& program_queue, int line_number, errorHandler error_handler) {
-    if (program_queue.size() < 2) {
+bool OperationHandler::quDivK(RingQueue<node>& program_queue, int line_number, errorHandler& error_handler) {
+    if (QU_UNLIKELY(program_queue.size() < 2)) {
         // Ensure that there are at least two elements in the queue
         error_handler.notEnoughArguments(line_number);
+        return false;
     }
 
-    node first_operand = program_queue.front();
-    program_queue.pop();
-    node second_operand = program_queue.front();
+    // The first operand is kept at the front of the queue, so only look at the operands.
+    const node& first_operand = program_queue.peek(0);
+    const node& second_operand = program_queue.peek(1);
 
     if (first_operand.containsInt() && second_operand.containsInt()) {
         // Check for division by zero
-        if (second_operand.getInt() == 0) {
+        if (QU_UNLIKELY(second_operand.getInt() == 0)) {
             error_handler.divisionByZero(line_number);
+            return false;
         }
 
         // Both operands are integers, perform integer division
-        int result = first_operand.getInt() / second_operand.getInt();
+        int64_t result = first_operand.getInt() / second_operand.getInt();
         program_queue.push(node(result));
     } else {
         // Error: DIV operation is only defined for integer operands
         error_handler.operationMismatch(line_number);
+        return false;
     }
-
-    // Create a new queue and add the first operand to it
-    std::queue<node> new_queue;
-    new_queue.push(first_operand);
-
-    // Add the rest of the original queue to the new queue
-    while (!program_queue.empty()) {
-        new_queue.push(program_queue.front());
-        program_queue.pop();
-    }
-
-    // Replace the original queue with the new queue
-    program_queue = new_queue;
+    return true;
 }
 
 /**
@@ -293,11 +275,13 @@ void OperationHandler::quDivK(std::queue<node>& program_queue, int line_number,
  * @param program_queue The queue for the program itself.
  * @param line_number The current line index in the program.
  * @param error_handler The interpreter's error handler.
+ * @return true if it succeeded, false if it reported an error.
  */
-void OperationHandler::quMod(std::queue<node>& program_queue, int line_number, errorHandler error_handler) {
-    if (program_queue.size() < 2) {
+bool OperationHandler::quMod(RingQueue<node>& program_queue, int line_number, errorHandler& error_handler) {
+    if (QU_UNLIKELY(program_queue.size() < 2)) {
         // Ensure that there are at least two elements in the queue
         error_handler.notEnoughArguments(line_number);
+        return false;
     }
 
     node first_operand = program_queue.front();
@@ -307,17 +291,20 @@ void OperationHandler::quMod(std::queue<node>& program_queue, int line_number, e
 
     if (first_operand.containsInt() && second_operand.containsInt()) {
         // Check for division by zero
-        if (second_operand.getInt() == 0) {
+        if (QU_UNLIKELY(second_operand.getInt() == 0)) {
             error_handler.divisionByZero(line_number);
+            return false;
         }
 
         // Both operands are integers, perform integer modulus
-        int result = first_operand.getInt() % second_operand.getInt();
+        int64_t result = first_operand.getInt() % second_operand.getInt();
         program_queue.push(node(result));
     } else {
         // Error: MOD operation is only defined for integer operands
         error_handler.operationMismatch(line_number);
+        return false;
     }
+    return true;
 }
 
 /**
@@ -326,41 +313,33 @@ void OperationHandler::quMod(std::queue<node>& program_queue, int line_number, e
  * @param program_queue The queue for the program itself.
  * @param line_number The current line index in the program.
  * @param error_handler The interpreter's error handler.
+ * @return true if it succeeded, false if it reported an error.
  */
-void OperationHandler::quModK(std::queue<node>& program_queue, int line_number, errorHandler error_handler) {
-    if (program_queue.size() < 2) {
+bool OperationHandler::quModK(RingQueue<node>& program_queue, int line_number, errorHandler& error_handler) {
+    if (QU_UNLIKELY(program_queue.size() < 2)) {
         // Ensure that there are at least two elements in the queue
         error_handler.notEnoughArguments(line_number);
+        return false;
     }
 
-    node first_operand = program_queue.front();
-    program_queue.pop();
-    node second_operand = program_queue.front();
+    // The first operand is kept at the front of the queue, so only look at the operands.
+    const node& first_operand = program_queue.peek(0);
+    const node& second_operand = program_queue.peek(1);
 
     if (first_operand.containsInt() && second_operand.containsInt()) {
         // Check for division by zero
-        if (second_operand.getInt() == 0) {
+        if (QU_UNLIKELY(second_operand.getInt() == 0)) {
             error_handler.divisionByZero(line_number);
+            return false;
         }
 
         // Both operands are integers, perform integer modulus
-        int result = first_operand.getInt() % second_operand.getInt();
+        int64_t result = first_operand.getInt() % second_operand.getInt();
         program_queue.push(node(result));
     } else {
         // Error: MOD operation is only defined for integer operands
         error_handler.operationMismatch(line_number);
+        return false;
     }
-
-    // Create a new queue and add the first operand to it
-    std::queue<node> new_queue;
-    new_queue.push(first_operand);
-
-    // Add the rest of the original queue to the new queue
-    while (!program_queue.empty()) {
-        new_queue.push(program_queue.front());
-        program_queue.pop();
-    }
-
-    // Replace the original queue with the new queue
-    program_queue = new_queue;
+    return true;
 }
\ No newline at end of file
@@ -2,18 +2,21 @@
 
 #include "../error/errorHandler.h"
 #include "../node/node.h"
-#include <queue>
+#include "../queue/ringQueue.h"
 
+/**
+ * The arithmetic instructions. Each returns false once it has reported an error, and the program must stop there.
+ */
 class OperationHandler {
 public:
-    static void quAdd(std::queue<node>& program_queue, int line_number, errorHandler error_handler);
-    static void quAddK(std::queue<node>& program_queue, int line_number, errorHandler error_handler);
-    static void quSub(std::queue<node>& program_queue, int line_number, errorHandler error_handler);
-    static void quSubK(std::queue<node>& program_queue, int line_number, errorHandler error_handler);
-    static void quMul(std::queue<node>& program_queue, int line_number, errorHandler error_handler);
-    static void quMulK(std::queue<node>& program_queue, int line_number, errorHandler error_handler);
-    static void quDiv(std::queue<node>& program_queue, int line_number, errorHandler error_handler);
-    static void quDivK(std::queue<node>& program_queue, int line_number, errorHandler error_handler);
-    static void quMod(std::queue<node>& program_queue, int line_number, errorHandler error_handler);
-    static void quModK(std::queue<node>& program_queue, int line_number, errorHandler error_handler);
+    static bool quAdd(RingQueue<node>& program_queue, int line_number, errorHandler& error_handler);
+    static bool quAddK(RingQueue<node>& program_queue, int line_number, errorHandler& error_handler);
+    static bool quSub(RingQueue<node>& program_queue, int line_number, errorHandler& error_handler);
+    static bool quSubK(RingQueue<node>& program_queue, int line_number, errorHandler& error_handler);
+    static bool quMul(RingQueue<node>& program_queue, int line_number, errorHandler& error_handler);
+    static bool quMulK(RingQueue<node>& program_queue, int line_number, errorHandler& error_handler);
+    static bool quDiv(RingQueue<node>& program_queue, int line_number, errorHandler& error_handler);
+    static bool quDivK(RingQueue<node>& program_queue, int line_number, errorHandler& error_handler);
+    static bool quMod(RingQueue<node>& program_queue, int line_number, errorHandler& error_handler);
+    static bool quModK(RingQueue<node>& program_queue, int line_number, errorHandler& error_handler);
 };
\ No newline at end of file
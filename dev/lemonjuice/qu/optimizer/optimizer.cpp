@@ -0,0 +1,242 @@
+#include "optimizer.h"
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "../compiler/compiler.h"
+#include "../operation/operationHandler.h"
+
+using namespace std;
+
+/**
+ * Finds every instruction some jump can land on.
+ *
+ * @param program The program.
+ * @return A flag per instruction, true if it is the target of a jump.
+ */
+static vector<bool> jumpTargets(const Program& program) {
+    vector<bool> targets(program.code.size(), false);
+    for (const Instruction& instruction : program.code) {
+        if (Compiler::isJump(instruction.opcode)) targets[instruction.int_operand] = true;
+    }
+    return targets;
+}
+
+/**
+ * Removes instructions from a program, moving every jump to follow the instruction it pointed at.
+ * A jump to a removed instruction lands on the next instruction that is kept.
+ *
+ * @param program The program.
+ * @param keep A flag per instruction, false for the ones to remove. The final Halt must be kept.
+ */
+static void removeInstructions(Program& program, const vector<bool>& keep) {
+    vector<int64_t> new_index(program.code.size());
+    int64_t kept = 0;
+    for (size_t i = 0; i < program.code.size(); i++) {
+        new_index[i] = kept;
+        if (keep[i]) kept++;
+    }
+
+    vector<Instruction> code;
+    code.reserve(kept);
+    for (size_t i = 0; i < program.code.size(); i++) {
+        if (!keep[i]) continue;
+        Instruction instruction = program.code[i];
+        if (Compiler::isJump(instruction.opcode)) instruction.int_operand = new_index[instruction.int_operand];
+        code.push_back(instruction);
+    }
+    program.code.swap(code);
+}
+
+/**
+ * Removes every instruction that can't be reached by falling through from the start or by a jump.
+ *
+ * @param program The program.
+ */
+static void removeUnreachable(Program& program) {
+    vector<bool> reachable(program.code.size(), false);
+    vector<size_t> pending = {0};
+    while (!pending.empty()) {
+        size_t index = pending.back();
+        pending.pop_back();
+        if (reachable[index]) continue;
+        reachable[index] = true;
+
+        const Instruction& instruction = program.code[index];
+        if (Compiler::isJump(instruction.opcode)) pending.push_back(static_cast<size_t>(instruction.int_operand));
+        if (instruction.opcode != Opcode::Goto && instruction.opcode != Opcode::Ret && instruction.opcode != Opcode::Halt) pending.push_back(index + 1);
+    }
+    reachable.back() = true; // The Halt always ends the code.
+    removeInstructions(program, reachable);
+}
+
+/**
+ * Checks if an integer operation on two known values would succeed without overflowing.
+ * Anything that would fail, or whose result isn't well defined, is left for the program to do at run time.
+ *
+ * @param opcode The operation, without its K.
+ * @param first The first operand.
+ * @param second The second operand.
+ * @return true if the operation can be done ahead of time.
+ */
+static bool safeToFold(Opcode opcode, int64_t first, int64_t second) {
+    const int64_t MAX = numeric_limits<int64_t>::max();
+    const int64_t MIN = numeric_limits<int64_t>::min();
+    switch (opcode) {
+        case Opcode::Add: return second > 0 ? first <= MAX - second : first >= MIN - second;
+        case Opcode::Sub: return second < 0 ? first <= MAX + second : first >= MIN + second;
+        case Opcode::Mul: {
+#ifdef __SIZEOF_INT128__
+            __int128 product = static_cast<__int128>(first) * second;
+            return product >= MIN && product <= MAX;
+#else
+            return false;
+#endif
+        }
+        case Opcode::Div:
+        case Opcode::Mod:
+            return second != 0 && !(first == MIN && second == -1);
+        default:
+            return false;
+    }
+}
+
+/**
+ * Folds the arithmetic at the very start of a program.
+ * Until the first jump target or instruction with an effect outside the queue, the queue holds only what the program has pushed,
+ * so the pushes and operations there can be run ahead of time and replaced by pushes of what they leave on the queue.
+ * Folding stops before any operation that would fail, so the program still fails at that operation's line.
+ *
+ * @param program The program.
+ */
+static void foldStartingConstants(Program& program) {
+    vector<bool> targets = jumpTargets(program);
+    RingQueue<node> known; // What the queue holds after the instructions folded so far.
+    errorHandler error_handler; // Never used, nothing that would fail is folded.
+    size_t end = 0;
+    bool folded_operation = false;
+
+    for (; end < program.code.size() && !targets[end]; end++) {
+        const Instruction& instruction = program.code[end];
+        Opcode opcode = instruction.opcode;
+        if (opcode == Opcode::PushInt) {
+            known.push(node(instruction.int_operand));
+            continue;
+        }
+        if (opcode == Opcode::PushString) {
+            known.push(node(program.strings[instruction.int_operand]));
+            continue;
+        }
+        if (opcode == Opcode::Empty) continue;
+
+        // Every other instruction that can be folded is an operation on the first two elements.
+        Opcode operation;
+        switch (opcode) {
+            case Opcode::Add: case Opcode::AddK: operation = Opcode::Add; break;
+            case Opcode::Sub: case Opcode::SubK: operation = Opcode::Sub; break;
+            case Opcode::Mul: case Opcode::MulK: operation = Opcode::Mul; break;
+            case Opcode::Div: case Opcode::DivK: operation = Opcode::Div; break;
+            case Opcode::Mod: case Opcode::ModK: operation = Opcode::Mod; break;
+            default: operation = Opcode::Halt; break;
+        }
+        if (operation == Opcode::Halt || known.size() < 2) break;
+
+        const node& first = known.peek(0);
+        const node& second = known.peek(1);
+        if (first.containsInt() && second.containsInt()) {
+            if (!safeToFold(operation, first.getInt(), second.getInt())) break;
+        }
+        else if (operation != Opcode::Add) break; // Only ADD works on strings, the rest would be an operation mismatch.
+
+        switch (opcode) {
+            case Opcode::Add: OperationHandler::quAdd(known, instruction.line, error_handler); break;
+            case Opcode::AddK: OperationHandler::quAddK(known, instruction.line, error_handler); break;
+            case Opcode::Sub: OperationHandler::quSub(known, instruction.line, error_handler); break;
+            case Opcode::SubK: OperationHandler::quSubK(known, instruction.line, error_handler); break;
+            case Opcode::Mul: OperationHandler::quMul(known, instruction.line, error_handler); break;
+            case Opcode::MulK: OperationHandler::quMulK(known, instruction.line, error_handler); break;
+            case Opcode::Div: OperationHandler::quDiv(known, instruction.line, error_handler); break;
+            case Opcode::DivK: OperationHandler::quDivK(known, instruction.line, error_handler); break;
+            case Opcode::Mod: OperationHandler::quMod(known, instruction.line, error_handler); break;
+            case Opcode::ModK: OperationHandler::quModK(known, instruction.line, error_handler); break;
+            default: break;
+        }
+        folded_operation = true;
+    }
+    if (!folded_operation || known.size() >= end) return;
+
+    // Replace the folded instructions with pushes of what they leave on the queue.
+    int line = program.code[end - 1].line;
+    vector<bool> keep(program.code.size(), true);
+    for (size_t i = 0; i < end; i++) {
+        if (i >= known.size()) {
+            keep[i] = false;
+            continue;
+        }
+        const node& value = known.peek(i);
+        if (value.containsInt()) program.code[i] = {Opcode::PushInt, line, value.getInt(), nullptr};
+        else {
+            program.strings.emplace_back(value.stringView());
+            program.code[i] = {Opcode::PushString, line, static_cast<int64_t>(program.strings.size() - 1), nullptr};
+        }
+    }
+    removeInstructions(program, keep);
+}
+
+/**
+ * Fuses pairs of instructions into superinstructions, so the pair costs one dispatch.
+ * PUSH of an integer followed by ADD, SUB, MUL, DIV or MOD becomes one instruction, unless something jumps to the operation.
+ * An IF* followed by a GOTO becomes a two way branch, and the GOTO stays where it is for anything that jumps to it.
+ *
+ * @param program The program.
+ */
+static void fuseSuperinstructions(Program& program) {
+    vector<bool> targets = jumpTargets(program);
+    vector<bool> keep(program.code.size(), true);
+    for (size_t i = 0; i + 1 < program.code.size(); i++) {
+        Instruction& instruction = program.code[i];
+        const Instruction& next = program.code[i + 1];
+
+        if (instruction.opcode == Opcode::PushInt && !targets[i + 1]) {
+            Opcode fused = Opcode::Halt;
+            switch (next.opcode) {
+                case Opcode::Add: fused = Opcode::PushAdd; break;
+                case Opcode::Sub: fused = Opcode::PushSub; break;
+                case Opcode::Mul: fused = Opcode::PushMul; break;
+                case Opcode::Div: fused = Opcode::PushDiv; break;
+                case Opcode::Mod: fused = Opcode::PushMod; break;
+                default: break;
+            }
+            if (fused != Opcode::Halt) {
+                instruction.opcode = fused;
+                instruction.line = next.line; // Only the operation can fail.
+                keep[++i] = false;
+            }
+            continue;
+        }
+
+        if (next.opcode != Opcode::Goto) continue;
+        switch (instruction.opcode) {
+            case Opcode::IfEq: instruction.opcode = Opcode::IfEqGoto; break;
+            case Opcode::IfGt: instruction.opcode = Opcode::IfGtGoto; break;
+            case Opcode::IfLt: instruction.opcode = Opcode::IfLtGoto; break;
+            case Opcode::IfNq: instruction.opcode = Opcode::IfNqGoto; break;
+            default: break;
+        }
+    }
+    removeInstructions(program, keep);
+}
+
+/**
+ * Optimizes a freshly compiled program.
+ *
+ * @param program The program, as the Compiler made it.
+ * @param level 0 to leave the program alone, 1 or 2 to optimize it (see the class comment).
+ */
+void Optimizer::optimize(Program& program, int level) {
+    if (level <= 0) return;
+    removeUnreachable(program);
+    if (level >= 2) foldStartingConstants(program);
+    fuseSuperinstructions(program);
+    program.optimization_level = level;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "../compiler/instruction.h"
+
+/**
+ * Rewrites a compiled program so it does the same thing in fewer instructions.
+ * Every pass keeps the exact queue semantics of OperationHandler, and every instruction that can fail keeps the line it
+ * reports errors at, so an optimized program fails in the same way and at the same line as the original.
+ *
+ * Level 1 removes code that nothing can reach and fuses common pairs of instructions into superinstructions.
+ * Level 2 also folds the arithmetic at the start of a program, where the whole queue is known, into the values it makes.
+ */
+class Optimizer {
+public:
+    static void optimize(Program& program, int level);
+};
@@ -0,0 +1,177 @@
+#include "outputSink.h"
+
+#include <charconv>
+#include <cstring>
+#ifdef _WIN32
+#include <io.h>
+#define isatty _isatty
+#define fileno _fileno
+#else
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+/**
+ * Creates a sink that writes to a file.
+ * Output to a terminal is flushed every line, anything else only when the buffer fills.
+ *
+ * @param file The file to write to, usually stdout.
+ */
+OutputSink::OutputSink(FILE* file) : file(file), capture(nullptr), buffer(BUFFER_SIZE) {
+    policy = isatty(fileno(file)) ? FlushPolicy::Line : FlushPolicy::Full;
+}
+
+/**
+ * Creates a sink that collects its output in a string.
+ *
+ * @param capture The string the output is appended to, it must outlive the sink.
+ */
+OutputSink::OutputSink(string& capture) : file(nullptr), capture(&capture), policy(FlushPolicy::Never), buffer(BUFFER_SIZE) {}
+
+/**
+ * Writes out anything still buffered, and stops the background writer if there is one.
+ */
+OutputSink::~OutputSink() {
+    flush();
+    if (writer.joinable()) {
+        {
+            lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        changed.notify_all();
+        writer.join();
+    }
+}
+
+void OutputSink::setFlushPolicy(FlushPolicy policy) {
+    this->policy = policy;
+}
+
+FlushPolicy OutputSink::getFlushPolicy() const {
+    return policy;
+}
+
+/**
+ * Moves the writing of full buffers to a thread of its own, so a slow reader of the output doesn't hold up the interpreter.
+ */
+void OutputSink::startBackgroundWriter() {
+    if (writer.joinable() || capture != nullptr) return;
+    pending.resize(BUFFER_SIZE);
+    writer = thread(&OutputSink::writerLoop, this);
+}
+
+/**
+ * Adds text to the output.
+ *
+ * @param text The text.
+ */
+void OutputSink::write(string_view text) {
+    if (text.size() > buffer.size() - used) {
+        flush();
+        // Text that wouldn't fit even in an empty buffer skips it, unless a background writer has to own the data.
+        if (text.size() >= buffer.size() && !writer.joinable()) {
+            writeOut(text.data(), text.size());
+            return;
+        }
+        while (text.size() > buffer.size()) {
+            memcpy(buffer.data(), text.data(), buffer.size());
+            used = buffer.size();
+            flush();
+            text.remove_prefix(buffer.size());
+        }
+    }
+    memcpy(buffer.data() + used, text.data(), text.size());
+    used += text.size();
+}
+
+/**
+ * Adds an integer to the output, in decimal.
+ *
+ * @param value The integer.
+ */
+void OutputSink::writeInt(int64_t value) {
+    char digits[24];
+    auto result = to_chars(digits, digits + sizeof(digits), value);
+    write(string_view(digits, result.ptr - digits));
+}
+
+/**
+ * Ends the current line, writing it out if every line is flushed.
+ */
+void OutputSink::endLine() {
+    write('\n');
+    if (policy == FlushPolicy::Line) flush();
+}
+
+/**
+ * Writes out a prompt before the interpreter waits for input, unless output is never flushed.
+ */
+void OutputSink::endPrompt() {
+    if (policy != FlushPolicy::Never) flush();
+}
+
+/**
+ * Writes out everything that is buffered.
+ * With a background writer the buffer is only handed over, and this waits only while the writer is still busy with the last one.
+ */
+void OutputSink::flush() {
+    if (used == 0) return;
+    if (!writer.joinable()) {
+        writeOut(buffer.data(), used);
+        used = 0;
+        return;
+    }
+
+    unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this] { return !pending_ready; });
+    buffer.swap(pending);
+    pending_size = used;
+    pending_ready = true;
+    used = 0;
+    lock.unlock();
+    changed.notify_all();
+}
+
+/**
+ * Writes out everything that is buffered and waits until it has been written, so whatever goes to the same stream next,
+ * such as an error on stderr, comes after it.
+ */
+void OutputSink::drain() {
+    flush();
+    if (!writer.joinable()) return;
+    unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this] { return !pending_ready; });
+}
+
+/**
+ * Writes data to wherever this sink's output goes.
+ *
+ * @param data The data.
+ * @param size The number of bytes of data.
+ */
+void OutputSink::writeOut(const char* data, size_t size) {
+    if (capture != nullptr) {
+        capture->append(data, size);
+        return;
+    }
+    fwrite(data, 1, size, file);
+    fflush(file);
+}
+
+/**
+ * The background writer, which writes each buffer it is handed until the sink is destroyed.
+ */
+void OutputSink::writerLoop() {
+    unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        changed.wait(lock, [this] { return pending_ready || stopping; });
+        if (!pending_ready) return;
+
+        lock.unlock();
+        writeOut(pending.data(), pending_size);
+        lock.lock();
+        pending_ready = false;
+        changed.notify_all();
+    }
+}
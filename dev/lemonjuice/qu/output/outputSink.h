@@ -0,0 +1,74 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/**
+ * When buffered output is actually written.
+ */
+enum class FlushPolicy {
+    Line,  // After every line, and before waiting for input.
+    Full,  // Whenever the buffer fills, and before waiting for input.
+    Never  // Only when the buffer fills or the sink is destroyed.
+};
+
+/**
+ * Everything a program prints goes through an OutputSink, which gathers it in a large buffer and writes it out in few, big writes.
+ * With a background writer the buffer is double buffered: a thread writes one buffer while the interpreter fills the other,
+ * so the interpreter only waits when it fills a buffer before the previous one has been written.
+ */
+class OutputSink {
+private:
+    static constexpr size_t BUFFER_SIZE = 1 << 16;
+
+    std::FILE* file;        // Where the output goes, unless it is captured.
+    std::string* capture;   // When not null, the output is appended here instead.
+    FlushPolicy policy;
+    std::vector<char> buffer;
+    size_t used = 0;
+
+    // Background writer state, guarded by mutex.
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<char> pending; // The buffer the writer is writing.
+    size_t pending_size = 0;
+    bool pending_ready = false;
+    bool stopping = false;
+
+    void writeOut(const char* data, size_t size);
+    void writerLoop();
+public:
+    explicit OutputSink(std::FILE* file);
+    explicit OutputSink(std::string& capture);
+    ~OutputSink();
+    OutputSink(const OutputSink&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+
+    void setFlushPolicy(FlushPolicy policy);
+    FlushPolicy getFlushPolicy() const;
+    void startBackgroundWriter();
+
+    /**
+     * Adds a single character to the output.
+     *
+     * @param c The character.
+     */
+    void write(char c) {
+        if (used == buffer.size()) flush();
+        buffer[used++] = c;
+    }
+
+    void write(std::string_view text);
+    void writeInt(int64_t value);
+    void endLine();
+    void endPrompt();
+    void flush();
+    void drain();
+};
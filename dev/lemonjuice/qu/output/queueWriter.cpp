@@ -0,0 +1,73 @@
+#include "queueWriter.h"
+
+using namespace std;
+
+/**
+ * Writes every element of the queue, front first, straight from the queue to the output.
+ * Nothing is copied, so this costs no memory however long the queue is.
+ * 
+ * @param out Where to write the queue.
+ * @param program_queue The queue for the program itself.
+ * @param format How to show the queue.
+ */
+void QueueWriter::write(OutputSink& out, const RingQueue<node>& program_queue, DisplayFormat format) {
+    if (format == DisplayFormat::Json) out.write('[');
+    for (size_t i = 0; i < program_queue.size(); i++) {
+        if (i > 0) out.write(", "); // Separate elements if there is more than one element in the queue
+        if (format == DisplayFormat::Json) program_queue.peek(i).writeNodeDisplay(out, true);
+        else program_queue.peek(i).p_print(out);
+    }
+    if (format == DisplayFormat::Json) out.write(']');
+}
+
+/**
+ * Writes every element of a queue of plain integers, exactly as the same values are written from a queue of nodes.
+ *
+ * @param out Where to write the queue.
+ * @param program_queue The queue for the program itself, on the integer engine.
+ * @param format How to show the queue.
+ */
+void QueueWriter::write(OutputSink& out, const RingQueue<int64_t>& program_queue, DisplayFormat format) {
+    if (format == DisplayFormat::Json) out.write('[');
+    for (size_t i = 0; i < program_queue.size(); i++) {
+        if (i > 0) out.write(", ");
+        if (format == DisplayFormat::Json) out.write("{\"nodeType\": \"int\", \"nodeValue\": ");
+        out.writeInt(program_queue.peek(i));
+        if (format == DisplayFormat::Json) out.write('}');
+    }
+    if (format == DisplayFormat::Json) out.write(']');
+}
+
+/**
+ * Writes text as a quoted JSON string, escaping whatever JSON doesn't allow inside one.
+ * 
+ * @param out Where to write the string.
+ * @param text The text of the string.
+ */
+void QueueWriter::writeJsonString(OutputSink& out, string_view text) {
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+
+    out.write('"');
+    size_t run_start = 0; // Characters that need no escaping are written in runs.
+    for (size_t i = 0; i < text.size(); i++) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+        out.write(text.substr(run_start, i - run_start));
+        run_start = i + 1;
+        switch (c) {
+            case '"': out.write("\\\""); break;
+            case '\\': out.write("\\\\"); break;
+            case '\n': out.write("\\n"); break;
+            case '\r': out.write("\\r"); break;
+            case '\t': out.write("\\t"); break;
+            default:
+                out.write("\\u00");
+                out.write(HEX_DIGITS[c >> 4]);
+                out.write(HEX_DIGITS[c & 0xF]);
+                break;
+        }
+    }
+    out.write(text.substr(run_start));
+    out.write('"');
+}
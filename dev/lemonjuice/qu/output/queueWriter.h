@@ -0,0 +1,22 @@
+#pragma once
+
+#include "../node/node.h"
+#include "../queue/ringQueue.h"
+#include "outputSink.h"
+#include <cstdint>
+#include <string_view>
+
+/**
+ * The ways QDISPLAY can show the queue.
+ */
+enum class DisplayFormat {
+    List, // The values separated by ", ", as PRINT/POP would show them.
+    Json  // A JSON array of node displays.
+};
+
+class QueueWriter {
+public:
+    static void write(OutputSink& out, const RingQueue<node>& program_queue, DisplayFormat format);
+    static void write(OutputSink& out, const RingQueue<int64_t>& program_queue, DisplayFormat format);
+    static void writeJsonString(OutputSink& out, std::string_view text);
+};
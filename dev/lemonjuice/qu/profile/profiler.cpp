@@ -0,0 +1,145 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <map>
+#include <string_view>
+#include "../compiler/compiler.h"
+
+using namespace std;
+
+// How many of the hottest lines the report lists.
+static const size_t REPORT_LINES = 20;
+
+/**
+ * Starts profiling a program, forgetting anything profiled before.
+ *
+ * @param program The program about to run.
+ */
+void Profiler::start(const Program& program) {
+    counters.clear();
+    for (const Instruction& instruction : program.code) {
+        Counter counter;
+        counter.opcode = instruction.opcode;
+        counter.line = instruction.line;
+        counters.push_back(counter);
+    }
+    current = NONE;
+    start_time = chrono::steady_clock::now();
+    start_tick = last_tick = tick();
+    running = true;
+}
+
+/**
+ * Stops profiling, charging the time since the last instruction started to it.
+ * Safe to call more than once, so it can be called both after a run and when the interpreter exits on an error.
+ */
+void Profiler::stop() {
+    if (!running) return;
+    uint64_t now = tick();
+    if (current != NONE) counters[current].ticks += now - last_tick;
+    total_ticks = now - start_tick;
+    double elapsed_ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start_time).count();
+    ns_per_tick = total_ticks > 0 ? elapsed_ns / total_ticks : 1;
+    current = NONE;
+    running = false;
+}
+
+// The totals of one opcode or one line.
+struct Totals {
+    uint64_t executions = 0;
+    uint64_t ticks = 0;
+};
+
+/**
+ * Writes a human readable report: time by opcode, the hottest lines and how every jump went.
+ *
+ * @param file Where to write the report, usually stderr.
+ */
+void Profiler::writeReport(FILE* file) const {
+    map<string_view, Totals> by_opcode; // By mnemonic, so every kind of PUSH is counted together.
+    map<int, Totals> by_line;
+    uint64_t executed = 0;
+    for (const Counter& counter : counters) {
+        if (counter.opcode == Opcode::Halt || counter.executions == 0) continue;
+        Totals& opcode_totals = by_opcode[Compiler::opcodeName(counter.opcode)];
+        opcode_totals.executions += counter.executions;
+        opcode_totals.ticks += counter.ticks;
+        by_line[counter.line].executions += counter.executions;
+        by_line[counter.line].ticks += counter.ticks;
+        executed += counter.executions;
+    }
+    double total_ns = nanoseconds(total_ticks);
+    auto percent = [total_ns](double ns) { return total_ns > 0 ? 100 * ns / total_ns : 0; };
+
+    fprintf(file, "Profile: %llu instructions in %.3f ms\n", static_cast<unsigned long long>(executed), total_ns / 1e6);
+
+    vector<pair<string_view, Totals>> opcodes(by_opcode.begin(), by_opcode.end());
+    sort(opcodes.begin(), opcodes.end(), [](const auto& a, const auto& b) { return a.second.ticks > b.second.ticks; });
+    fprintf(file, "\n%-10s %14s %14s %8s %10s\n", "Opcode", "Count", "Time (ms)", "Time %", "ns/op");
+    for (const auto& [name, totals] : opcodes) {
+        double ns = nanoseconds(totals.ticks);
+        fprintf(file, "%-10.*s %14llu %14.3f %7.2f%% %10.1f\n", static_cast<int>(name.size()), name.data(), static_cast<unsigned long long>(totals.executions),
+                ns / 1e6, percent(ns), ns / totals.executions);
+    }
+
+    vector<pair<int, Totals>> lines(by_line.begin(), by_line.end());
+    sort(lines.begin(), lines.end(), [](const auto& a, const auto& b) { return a.second.ticks > b.second.ticks; });
+    if (lines.size() > REPORT_LINES) lines.resize(REPORT_LINES);
+    fprintf(file, "\n%-10s %14s %14s %8s\n", "Line", "Count", "Time (ms)", "Time %");
+    for (const auto& [line, totals] : lines) {
+        double ns = nanoseconds(totals.ticks);
+        fprintf(file, "%-10d %14llu %14.3f %7.2f%%\n", line, static_cast<unsigned long long>(totals.executions), ns / 1e6, percent(ns));
+    }
+
+    bool any_jumps = false;
+    for (const Counter& counter : counters) {
+        if (!Compiler::isJump(counter.opcode)) continue;
+        if (!any_jumps) fprintf(file, "\n%-10s %-10s %14s %14s\n", "Line", "Jump", "Taken", "Not taken");
+        any_jumps = true;
+        fprintf(file, "%-10d %-10s %14llu %14llu\n", counter.line, Compiler::opcodeName(counter.opcode),
+                static_cast<unsigned long long>(counter.taken), static_cast<unsigned long long>(counter.executions - counter.taken));
+    }
+}
+
+/**
+ * Writes everything the profiler counted as JSON, per instruction, per opcode and per line.
+ *
+ * @param file Where to write the JSON.
+ */
+void Profiler::writeJson(FILE* file) const {
+    map<string_view, Totals> by_opcode; // By mnemonic, so every kind of PUSH is counted together.
+    map<int, Totals> by_line;
+    for (const Counter& counter : counters) {
+        if (counter.opcode == Opcode::Halt) continue;
+        Totals& opcode_totals = by_opcode[Compiler::opcodeName(counter.opcode)];
+        opcode_totals.executions += counter.executions;
+        opcode_totals.ticks += counter.ticks;
+        by_line[counter.line].executions += counter.executions;
+        by_line[counter.line].ticks += counter.ticks;
+    }
+
+    fprintf(file, "{\n  \"totalNs\": %.0f,\n  \"opcodes\": [", nanoseconds(total_ticks));
+    const char* separator = "\n";
+    for (const auto& [name, totals] : by_opcode) {
+        fprintf(file, "%s    {\"opcode\": \"%.*s\", \"count\": %llu, \"ns\": %.0f}", separator, static_cast<int>(name.size()), name.data(),
+                static_cast<unsigned long long>(totals.executions), nanoseconds(totals.ticks));
+        separator = ",\n";
+    }
+    fprintf(file, "\n  ],\n  \"lines\": [");
+    separator = "\n";
+    for (const auto& [line, totals] : by_line) {
+        fprintf(file, "%s    {\"line\": %d, \"count\": %llu, \"ns\": %.0f}", separator, line,
+                static_cast<unsigned long long>(totals.executions), nanoseconds(totals.ticks));
+        separator = ",\n";
+    }
+    fprintf(file, "\n  ],\n  \"jumps\": [");
+    separator = "\n";
+    for (const Counter& counter : counters) {
+        if (!Compiler::isJump(counter.opcode)) continue;
+        fprintf(file, "%s    {\"line\": %d, \"opcode\": \"%s\", \"taken\": %llu, \"notTaken\": %llu}", separator, counter.line,
+                Compiler::opcodeName(counter.opcode), static_cast<unsigned long long>(counter.taken),
+                static_cast<unsigned long long>(counter.executions - counter.taken));
+        separator = ",\n";
+    }
+    fprintf(file, "\n  ]\n}\n");
+}
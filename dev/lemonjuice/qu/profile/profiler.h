@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include "../compiler/instruction.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * Counts how often every instruction of a program runs, how long it takes and how often its jump is taken, for --profile.
+ * The executor only calls into the profiler from its profiled build, so an ordinary run pays nothing for it.
+ * Time is measured in timestamp counter ticks where the processor has one, and converted to nanoseconds against the clock at the end.
+ */
+class Profiler {
+private:
+    static constexpr size_t NONE = static_cast<size_t>(-1);
+
+    struct Counter {
+        Opcode opcode;
+        int line;
+        uint64_t executions = 0;
+        uint64_t ticks = 0;
+        uint64_t taken = 0; // Jumps only.
+    };
+
+    std::vector<Counter> counters; // One per instruction.
+    size_t current = NONE;         // The instruction that is running, which the time since last_tick belongs to.
+    uint64_t last_tick = 0;
+    uint64_t start_tick = 0;
+    uint64_t total_ticks = 0;
+    std::chrono::steady_clock::time_point start_time;
+    double ns_per_tick = 1;
+    bool running = false;
+
+    static uint64_t tick() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    double nanoseconds(uint64_t ticks) const { return ticks * ns_per_tick; }
+public:
+    void start(const Program& program);
+    void stop();
+
+    /**
+     * Marks the start of an instruction, which also ends the one before it.
+     *
+     * @param index The index of the instruction.
+     */
+    void enter(size_t index) {
+        uint64_t now = tick();
+        if (current != NONE) counters[current].ticks += now - last_tick;
+        counters[index].executions++;
+        current = index;
+        last_tick = now;
+    }
+
+    /**
+     * Records that a jump was taken.
+     *
+     * @param index The index of the jump instruction.
+     */
+    void taken(size_t index) { counters[index].taken++; }
+
+    void writeReport(std::FILE* file) const;
+    void writeJson(std::FILE* file) const;
+};
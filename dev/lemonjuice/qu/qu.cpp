@@ -1,64 +1,174 @@
 #include <algorithm>
 #include <cctype>
+#include <charconv>
+#include <cstdio>
 #include <cstdlib>
 #include <ctime>
 #include <fstream>
 #include <iostream>
 #include <iterator>
-#include <map>
-#include <queue>
 #include <sstream>
 #include <string>
+#include <utility>
 #include <vector>
-#include "error\errorHandler.h"
-#include "node\node.h"
-#include "operation\operationHandler.h"
+#include "batch/batchRunner.h"
+#include "bytecode/bytecodeFile.h"
+#include "compiler/compiler.h"
+#include "error/errorHandler.h"
+#include "executor/executor.h"
+#include "input/inputReader.h"
+#include "interpreter/interpreter.h"
+#include "metrics/runtimeMetrics.h"
+#include "node/node.h"
+#include "operation/operationHandler.h"
+#include "optimizer/optimizer.h"
+#include "output/outputSink.h"
+#include "profile/profiler.h"
+#include "queue/ringQueue.h"
+#include "random/randomSource.h"
+#include "source/sourceFile.h"
+#include "transpiler/cppTranspiler.h"
 
 using namespace std;
 
 // Globals
 errorHandler error_handler; // error_handler to handle errors.
-queue<node> program_queue; // Queue, that represents the queue, that is the memory of the program.
-map<string, int> saved_positions; // Map that stores the positions the programmer dictated for GOTOs.
+Interpreter interpreter; // Runs the program, and holds the queue that is the memory of the program.
+InputReader program_input(0); // Reads the program's input from stdin.
+OutputSink program_output(stdout); // Buffers everything the program prints, flushed when it is destroyed at exit.
+Profiler program_profiler; // Collects the profile for --profile.
+string profile_path; // Where --profile writes its JSON, empty when not profiling.
 
 // Prototypes
 bool fileArgChecker(int argc);
-int run(vector<string> program_text);
-bool isInteger(string str);
-bool compareFirstTwo(const std::queue<node>& program_queue, string comparisonType, int line);
+DispatchMode parseDispatchMode(const string& option);
+FlushPolicy parseFlushPolicy(const string& option);
+uint64_t parseSeed(const string& option);
+unsigned parseJobs(const string& option);
+void writeProfile();
+void writeMetrics();
+Program loadProgram(const SourceFile& source, uint64_t source_hash, int optimization_level, bool use_cache);
+int run(Program& program, DispatchMode dispatch_mode, bool verbose, bool jit);
 
 /**
  * This is the main entryway into the interpreter.
  */
 int main(int argc, char *argv[]){
+    // Separate the options from the file argument.
+    DispatchMode dispatch_mode = QU_THREADED_DISPATCH ? DispatchMode::Threaded : DispatchMode::Switch;
+    bool verbose = false;
+    bool use_cache = true;
+    bool jit = false;
+    bool emit_cpp = false; // Whether to write the program out as C++ instead of running it.
+    bool metrics = false; // Whether to write the metrics when the interpreter exits.
+    int optimization_level = 0;
+    string compile_path; // Where --compile writes the compiled program, empty to run it instead.
+    string batch_path; // The manifest --batch runs the programs of, empty to run a single program.
+    BatchOptions batch_options;
+    vector<string> file_args;
+    error_handler.setOutput(&program_output);
+    for (int arg = 1; arg < argc; arg++) {
+        string current_arg = argv[arg];
+        if (current_arg.rfind("--dispatch=", 0) == 0) dispatch_mode = parseDispatchMode(current_arg.substr(11));
+        else if (current_arg.rfind("--flush=", 0) == 0) program_output.setFlushPolicy(parseFlushPolicy(current_arg.substr(8)));
+        else if (current_arg.rfind("--seed=", 0) == 0) {
+            batch_options.seed = parseSeed(current_arg.substr(7));
+            batch_options.seeded = true;
+            interpreter.seed(batch_options.seed);
+        }
+        else if (current_arg == "--verbose") verbose = true;
+        else if (current_arg == "--no-cache") use_cache = false;
+        else if (current_arg == "--jit") jit = true;
+        else if (current_arg == "--emit-cpp") emit_cpp = true;
+        else if (current_arg == "-O0" || current_arg == "-O1" || current_arg == "-O2") optimization_level = current_arg[2] - '0';
+        else if (current_arg == "--profile") profile_path = "qu-profile.json";
+        else if (current_arg.rfind("--profile=", 0) == 0) profile_path = current_arg.substr(10);
+        else if (current_arg == "--metrics") metrics = true;
+        else if (current_arg.rfind("--metrics=", 0) == 0) {
+            RuntimeMetrics::setDestination(current_arg.substr(10));
+            metrics = true;
+        }
+        else if (current_arg.rfind("--compile=", 0) == 0) compile_path = current_arg.substr(10);
+        else if (current_arg == "--compile") {
+            if (arg + 1 == argc) error_handler.unknownOption(current_arg);
+            compile_path = argv[++arg];
+        }
+        else if (current_arg.rfind("--batch=", 0) == 0) batch_path = current_arg.substr(8);
+        else if (current_arg == "--batch" || current_arg == "-j") {
+            if (arg + 1 == argc) error_handler.unknownOption(current_arg);
+            if (current_arg == "-j") batch_options.threads = parseJobs(argv[++arg]);
+            else batch_path = argv[++arg];
+        }
+        else if (current_arg.rfind("-j", 0) == 0) batch_options.threads = parseJobs(current_arg.substr(2));
+        else if (current_arg.rfind("--jobs=", 0) == 0) batch_options.threads = parseJobs(current_arg.substr(7));
+        else if (current_arg == "--async-output") program_output.startBackgroundWriter();
+        else if (current_arg.rfind("--", 0) == 0) error_handler.unknownOption(current_arg);
+        else file_args.push_back(current_arg);
+    }
+
+    // However often --metrics is given, the report is written once.
+    if (metrics) atexit(writeMetrics);
+
+    // SIGUSR1 asks a running program for its metrics.
+    RuntimeMetrics::listenForSignal();
+
+    // --batch runs every program in its manifest, each with files of its own, instead of a single program.
+    if (!batch_path.empty()) {
+        if (!file_args.empty()) error_handler.extraFileArguments(file_args.size() + 1, 1);
+        batch_options.optimization_level = optimization_level;
+        batch_options.dispatch_mode = dispatch_mode;
+        batch_options.jit = jit;
+        if (!BatchRunner::run(batch_path, batch_options, program_output)) error_handler.invalidBatchManifest(batch_path);
+        return 0;
+    }
+
     // Handle all file stuff before interpretation.
-    fileArgChecker(argc); // Check for the correct number of arguments.
-    fstream program_file; // File passed as an argument.
-    program_file.open(argv[1], ios::in); // Sets the file as a read-only file.
-    string file_name = argv[1]; // Get the file's name.
+    fileArgChecker(file_args.size() + 1); // Check for the correct number of arguments.
+    string file_name = file_args[0]; // Get the file's name.
 
     // This section doesn't seem to work 100% correctly. 
+    bool is_bytecode = false; // Whether the file is an already compiled ".quc" program.
     size_t last_dot_pos = file_name.find_last_of('.'); // Find the last dot in the file's name.
     if (last_dot_pos != string::npos) { // Checking if the '.' is found in the file's name.
         string file_extension = file_name.substr(last_dot_pos + 1); // Get the file's extension.
-        if(file_extension != "qu") error_handler.invalidFileExtension(file_name); // Error sequence for invalid file extensions.
+        is_bytecode = file_extension == "quc";
+        if(file_extension != "qu" && !is_bytecode) error_handler.invalidFileExtension(file_name); // Error sequence for invalid file extensions.
     }
     else error_handler.invalidFileExtension(file_name); // Error sequence for invalid file extensions.
 
-    // Moves the file contents into the program.
-    vector<string> program_text; // The text of the program in string vector form.
-    if(program_file.is_open()){
-        string line;
-        while (getline(program_file, line)) program_text.push_back(line);
+    // Maps the file into memory, the lines of the program point straight into it.
+    SourceFile program_file; // File passed as an argument.
+    bool opened = program_file.open(file_name);
+    uint64_t source_hash = 0;
+    Program program;
+    if (is_bytecode) {
+        if (!opened || !BytecodeFile::load(program_file.text(), program, source_hash)) error_handler.invalidBytecodeFile(file_name);
+    }
+    else {
+        // Echo the program back, for debugging.
+        if (verbose) {
+            cout << "Program Start: " << endl;
+            for (string_view line : program_file.lines()) cout << "\t" << line << endl;
+            cout << "Program End" << endl;
+        }
+
+        source_hash = BytecodeFile::hashSource(program_file.text());
+        program = loadProgram(program_file, source_hash, optimization_level, use_cache && compile_path.empty());
     }
-    program_file.close();
 
-    // This is a test to just print output.
-    cout << "Program Start: " << endl;
-    for (const auto& line : program_text) std::cout << "\t" << line << std::endl;
-    cout << "Program End" << endl;
+    // --emit-cpp only translates the program, to standard output.
+    if (emit_cpp) {
+        program_output.write(CppTranspiler::translate(program, file_name));
+        return 0;
+    }
+
+    // --compile only writes the program out.
+    if (!compile_path.empty()) {
+        if (!BytecodeFile::save(program, source_hash, compile_path)) error_handler.bytecodeWriteFailed(compile_path);
+        return 0;
+    }
 
-    return run(program_text);
+    return run(program, dispatch_mode, verbose, jit);
 }
 
 /**
@@ -78,517 +188,135 @@ bool fileArgChecker(int argc){
 }
 
 /**
- * The actual run section of the program for the interpreter.
+ * Reads the value of the --dispatch option.
  * 
- * @param program_text The actual text that is the program.
- * @return true if argc is correct, the program will error and end otherwise.
+ * @param option The text after "--dispatch=".
+ * @return The dispatch mode that was asked for, the program will error and end otherwise.
  */
-int run(vector<string> program_text){
-    // This is just for debug
-    cout << "Output Start: " << endl;
-
-    // On the first run through of the program we should find all the saved positions and save to the saved_positions map<string, int>.
-    for(int i = 0; i < program_text.size(); i++){
-        string current_line = program_text[i];
-        if (current_line.find('|') != std::string::npos) {
-            size_t bar_pos1 = current_line.find('|'); //The first occurrence of '|'
-            size_t bar_pos2 = current_line.rfind('|'); //The last occurrence of '|'
-            if(bar_pos1 == bar_pos2) error_handler.singleBarError(bar_pos1, i);
-            else {
-                string save = current_line.substr(bar_pos1+1, bar_pos2-1);
-                saved_positions.insert({save, i});
-            }
-        }
-    }
-
-    // This will be used for map stuff later
-    //if(saved_positions.at("HELP") == 2) cout << "True" << endl;
-
-    // Run the code for real this time.
-    for(int i = 0; i < program_text.size(); i++){
-        string current_line = program_text[i];
-
-        // Skip empty lines and lines starting with '|'
-        if(current_line.empty() || current_line.find_first_not_of(" \t") == string::npos || current_line[0] == '|') {
-            continue;
-        }
-
-        // ADD
-        if (current_line.find("ADD") != string::npos) {
-            OperationHandler::quAdd(program_queue, i, error_handler);
-        }
-
-        // ADDK
-        if (current_line.find("ADDK") != string::npos) {
-            OperationHandler::quAddK(program_queue, i, error_handler);
-        }
-
-        // DIV
-        if(current_line.find("DIV") != string::npos){
-            OperationHandler::quSub(program_queue, i, error_handler);
-        }
-
-        // DIVK
-        if(current_line.find("DIVK") != string::npos){
-            OperationHandler::quSubK(program_queue, i, error_handler);
-        }
-
-        // EMPTY 
-        if (current_line.find("EMPTY") != string::npos) {
-            (void) program_queue.empty(); // Ignoring the return value intentionally
-        }
-
-        // GOTO 
-        size_t goto_pos = current_line.find("GOTO");
-        if (goto_pos != std::string::npos && (goto_pos == 0 || current_line[goto_pos - 1] == ' ')) {
-            // Extract the argument of the GOTO instruction
-            std::string arg = current_line.substr(goto_pos + 5); // +5 to skip "GOTO "
-
-            // Check if the argument is a line number or a saved position
-            int line_number;
-            if (isInteger(arg)) {
-                // Argument is a line number
-                line_number = std::stoi(arg);
-            } else {
-                // Argument is a saved position
-                if (saved_positions.find(arg) != saved_positions.end()) {
-                    // Jump to the saved position
-                    i = saved_positions[arg];
-                    continue; // Skip the rest of the loop to avoid processing the new line again
-                } else {
-                    // Error: Invalid saved position
-                    error_handler.invalidGoto(i);
-                }
-            }
-
-            // Check if the line number is valid
-            if (line_number >= 0 && line_number < program_text.size()) {
-                // Jump to the specified line
-                i = line_number;
-                continue; // Skip the rest of the loop to avoid processing the new line again
-            } else {
-                // Error: Invalid line number
-                error_handler.invalidGoto(i);
-            }
-        }   
-
-        // IFEQ
-        size_t ifeq_pos = current_line.find("IFEQ");
-        if (ifeq_pos != std::string::npos && (ifeq_pos == 0 || current_line[ifeq_pos - 1] == ' ')) {
-            // Extract the argument of the IFEQ instruction
-            std::string arg = current_line.substr(ifeq_pos + 5); // +5 to skip "IFEQ "
-
-            // Parse the argument to extract the line number or saved position
-            int jump_line;
-            if (isInteger(arg)) {
-                jump_line = std::stoi(arg);
-            } else {
-                if (saved_positions.find(arg) != saved_positions.end()) {
-                    jump_line = saved_positions[arg];
-                } else {
-                    error_handler.unknownInstruction(i);
-                    continue;
-                }
-            }
-
-            // Check if the condition is met using compareFirstTwo function
-            if (compareFirstTwo(program_queue, "==", i)) {
-                // Jump to the specified line
-                i = jump_line;
-                continue;
-            }
-        }
-
-        // IFGT
-        size_t ifgt_pos = current_line.find("IFGT");
-        if (ifgt_pos != std::string::npos && (ifgt_pos == 0 || current_line[ifgt_pos - 1] == ' ')) {
-            std::string arg = current_line.substr(ifgt_pos + 5); // +5 to skip "IFGT "
-
-            // Parse the argument to extract the line number or saved position
-            int jump_line;
-            if (isInteger(arg)) {
-                jump_line = std::stoi(arg);
-            } else {
-                if (saved_positions.find(arg) != saved_positions.end()) {
-                    jump_line = saved_positions[arg];
-                } else {
-                    error_handler.unknownInstruction(i);
-                    continue;
-                }
-            }
-
-            // Check if the condition is met using compareFirstTwo function
-            if (compareFirstTwo(program_queue, ">", i)) {
-                // Jump to the specified line
-                i = jump_line;
-                continue;
-            }
-        }
-
-        // IFLT
-        size_t iflt_pos = current_line.find("IFLT");
-        if (iflt_pos != std::string::npos && (iflt_pos == 0 || current_line[iflt_pos - 1] == ' ')) {
-            std::string arg = current_line.substr(iflt_pos + 5); // +5 to skip "IFLT "
-
-            // Parse the argument to extract the line number or saved position
-            int jump_line;
-            if (isInteger(arg)) {
-                jump_line = std::stoi(arg);
-            } else {
-                if (saved_positions.find(arg) != saved_positions.end()) {
-                    jump_line = saved_positions[arg];
-                } else {
-                    error_handler.unknownInstruction(i);
-                    continue;
-                }
-            }
-
-            // Check if the condition is met using compareFirstTwo function
-            if (compareFirstTwo(program_queue, "<", i)) {
-                // Jump to the specified line
-                i = jump_line;
-                continue;
-            }
-        }
-
-        // IFNQ
-        size_t ifnq_pos = current_line.find("IFNQ");
-        if (ifnq_pos != std::string::npos && (ifnq_pos == 0 || current_line[ifnq_pos - 1] == ' ')) {
-            std::string arg = current_line.substr(ifnq_pos + 5); // +5 to skip "IFNQ "
-
-            // Parse the argument to extract the line number or saved position
-            int jump_line;
-            if (isInteger(arg)) {
-                jump_line = std::stoi(arg);
-            } else {
-                if (saved_positions.find(arg) != saved_positions.end()) {
-                    jump_line = saved_positions[arg];
-                } else {
-                    error_handler.unknownInstruction(i);
-                    continue;
-                }
-            }
-
-            // Check if the condition is met using compareFirstTwo function
-            if (compareFirstTwo(program_queue, "!=", i)) {
-                // Jump to the specified line
-                i = jump_line;
-                continue;
-            }
-        }
-
-        // MOD
-        if(current_line.find("MOD") != string::npos){
-            OperationHandler::quMod(program_queue, i, error_handler);
-        }
-
-        // MODK
-        if(current_line.find("MODK") != string::npos){
-            OperationHandler::quModK(program_queue, i, error_handler);
-        }
-
-        // MUL
-        if(current_line.find("MUL") != string::npos){
-            OperationHandler::quMul(program_queue, i, error_handler);
-        }
-
-        // MULK
-        if(current_line.find("MULK") != string::npos){
-            OperationHandler::quMulK(program_queue, i, error_handler);
-        }
-
-        // PEEK & PEEKLN
-        if(current_line.find("PEEK") != string::npos){
-            node current_node = program_queue.front();
-
-            if(current_line.find("LN") != string::npos) {
-                if(current_line.find("PEEKLN") != string::npos) current_node.p_println(); // PEEKLN
-                else error_handler.unknownInstruction(i);
-            }
-            else current_node.p_print(); // PEEK
-        }
-
-        // POKE
-        if (current_line.find("POKE") != string::npos) {
-            // Convert the queue to a temporary vector
-            vector<node> temp_vector;
-            while (!program_queue.empty()) {
-                temp_vector.push_back(program_queue.front());
-                program_queue.pop();
-            }
-
-            // Shuffle the elements of the temporary vector
-            std::srand(std::time(0)); // Seed the random number generator
-            for (size_t i = temp_vector.size() - 1; i > 0; --i) {
-                size_t j = std::rand() % (i + 1); // Generate a random index between 0 and i
-                std::swap(temp_vector[i], temp_vector[j]); // Swap elements at indices i and j
-            }
-
-            // Push the shuffled elements back into the queue
-            for (const auto& elem : temp_vector) {
-                program_queue.push(elem);
-            }
-        }
-
-        // POP, POPLN, POPALL & POPALLLN
-        if (current_line.find("POP") != string::npos) {
-            bool pop_all = current_line.find("ALL") != string::npos; // Check if "ALL" is present
-            bool print_newline = current_line.find("LN") != string::npos; // Check if "LN" is present
-    
-            if (pop_all) {
-                while (!program_queue.empty()) {
-                    node current_node = program_queue.front();
-                    program_queue.pop();
-                    if (print_newline) current_node.p_println(); // Print each popped element on a new line
-                    else current_node.p_print(); // Print each popped element
-                }
-            } else {
-                node current_node = program_queue.front();
-                if (print_newline) current_node.p_println(); // POPLN
-                else current_node.p_print(); // POP
-                program_queue.pop(); // This has to be done separately because ".pop()" doesn't return anything... why? Because who could ever want to see what the first element in a FIFO data structure was.
-            }
-        }
-
-        // PRINT
-        size_t print_pos = current_line.find("PRINT");
-        if (print_pos != std::string::npos && (print_pos == 0 || current_line[print_pos - 1] == ' ')) {
-            // Extract the argument of the PRINT instruction
-            std::string arg = current_line.substr(print_pos + 6); // +6 to skip "PRINT "
-
-            // Remove leading and trailing double quotes if they exist
-            if (!arg.empty() && arg.front() == '"' && arg.back() == '"') {
-                arg = arg.substr(1, arg.length() - 2);
-            }
-
-            // Print the argument
-            std::cout << arg << std::endl;
-        }
-
-        // PUSH
-        if (current_line.find("PUSH") != string::npos) {
-            size_t quote_pos1 = current_line.find('\"'); // The first occurrence of '\"'
-            size_t quote_pos2 = current_line.rfind('\"'); // The last occurrence of '\"'
-
-            if (quote_pos1 != std::string::npos && quote_pos2 != std::string::npos) {
-                // If quotes are found, it's a string
-                if (quote_pos1 != quote_pos2) {
-                    string push_string = current_line.substr(quote_pos1 + 1, quote_pos2 - quote_pos1 - 1); // Extract substring between quotes
-
-                    // Replace escape sequences with their corresponding characters
-                    for (size_t pos = push_string.find('\\'); pos != std::string::npos; pos = push_string.find('\\', pos + 1)) {
-                        if (push_string[pos + 1] == 'n') { // Check for newline escape sequence
-                            push_string.replace(pos, 2, "\n"); // Replace "\n" with newline character
-                        }
-                    }
-
-                    node new_node = node(push_string);
-                    program_queue.push(new_node);
-                } else {
-                    error_handler.invalidPush(i);
-                }
-            } else {
-                // If quotes are not found, treat it as an integer
-                string second_half = current_line.substr(current_line.find("PUSH") + 5); // +5 to skip "PUSH "
-                if (isInteger(second_half)) {
-                    int push_int = stoi(second_half);
-                    cout << "Pushing integer: " << push_int << endl; // Debugging output
-                    node new_node = node(push_int);
-                    program_queue.push(new_node);
-                } else {
-                    error_handler.invalidPush(i);
-                }
-            }
-        }
-
-        // QDISPLAY
-        if (current_line.find("QDISPLAY") != string::npos) {queue<node> temp_queue = program_queue; // Create a copy of the original queue
-            while (!temp_queue.empty()) {
-                node current_node = temp_queue.front();
-                temp_queue.pop();
-                current_node.p_print(); // Print each popped element
-                if (!temp_queue.empty()) cout << ", "; // Print comma to separate elements if there are more elements in the queue
-            }
-            cout << endl;
-        }
-
-        // READ
-        size_t read_pos = current_line.find("READ");
-        if (read_pos != std::string::npos && (read_pos == 0 || current_line[read_pos - 1] == ' ')) {
-            // Extract the argument of the READ instruction
-            std::string arg = current_line.substr(read_pos + 5); // +5 to skip "READ "
-
-            // Remove leading and trailing double quotes if they exist
-            if (!arg.empty() && arg.front() == '"' && arg.back() == '"') {
-                arg = arg.substr(1, arg.length() - 2);
-            }
-
-            // Print the argument
-            std::cout << arg;
-
-            // Read a line from the user
-            std::string line;
-            std::getline(std::cin, line);
-
-            // Attempt to convert the line into an integer
-            bool is_integer = true;
-            try {
-                int value = std::stoi(line);
-                // If successful, push the integer to the queue
-                program_queue.push(node(value));
-            } catch (std::invalid_argument&) {
-                // If conversion fails, push the line as a string to the queue
-                is_integer = false;
-                program_queue.push(node(line));
-            }
-        }
-
-        // RET
-        if (current_line.find("RET") != std::string::npos) {
-            // Check if the queue is empty
-            if (program_queue.empty()) {
-                error_handler.returnFromEmptyQueue(i);
-                return -1; // End the program with an error code
-            } else {
-                // Get the front of the queue
-                node front_node = program_queue.front();
-                program_queue.pop();
-                // Return the value of the front of the queue
-                if (front_node.containsInt()) {
-                    return front_node.getInt();
-                } else {
-                    error_handler.nonIntegerReturnValue(i);
-                }
-            }
-        }
-
-        // SUB
-        if(current_line.find("SUB") != string::npos){
-            OperationHandler::quSub(program_queue, i, error_handler);
-        }
-
-        // SUBK
-        if(current_line.find("SUBK") != string::npos){
-            OperationHandler::quSubK(program_queue, i, error_handler);
-        }
-
-        // SORTUP
-        if (current_line.find("SORTUP") != string::npos) {
-            // Copy elements of the queue to a temporary vector
-            vector<node> temp_vector;
-            while (!program_queue.empty()) {
-                temp_vector.push_back(program_queue.front());
-                program_queue.pop();
-            }
-
-            // Sort the temporary vector
-            sort(temp_vector.begin(), temp_vector.end(), [](const node &a, const node &b) {
-                if (a.containsInt() && b.containsInt()) {
-                    return a.getInt() < b.getInt(); // Sort integers in ascending order
-                } else if (!a.containsInt() && !b.containsInt()) {
-                    return a.getString() < b.getString(); // Sort strings in ascending order
-                } else {
-                    // If types are different, prioritize integers over strings
-                    return a.containsInt();
-                }
-            });
-
-            // Push sorted elements back to the queue
-            for (const auto &elem : temp_vector) {
-                program_queue.push(elem);
-            }
-        }
+DispatchMode parseDispatchMode(const string& option){
+    if (option == "switch") return DispatchMode::Switch;
+    if (option != "threaded") error_handler.unknownOption("--dispatch=" + option);
+    return DispatchMode::Threaded;
+}
 
-        // SORTDOWN
-        if (current_line.find("SORTDOWN") != string::npos) {
-            // Copy elements of the queue to a temporary vector
-            vector<node> temp_vector;
-            while (!program_queue.empty()) {
-                temp_vector.push_back(program_queue.front());
-                program_queue.pop();
-            }
+/**
+ * Reads the value of the --flush option.
+ * 
+ * @param option The text after "--flush=".
+ * @return The flush policy that was asked for, the program will error and end otherwise.
+ */
+FlushPolicy parseFlushPolicy(const string& option){
+    if (option == "line") return FlushPolicy::Line;
+    if (option == "full") return FlushPolicy::Full;
+    if (option != "never") error_handler.unknownOption("--flush=" + option);
+    return FlushPolicy::Never;
+}
 
-            // Sort the temporary vector
-            sort(temp_vector.begin(), temp_vector.end(), [](const node &a, const node &b) {
-                if (a.containsInt() && b.containsInt()) {
-                    return a.getInt() > b.getInt(); // Sort integers in descending order
-                } else if (!a.containsInt() && !b.containsInt()) {
-                    return a.getString() > b.getString(); // Sort strings in descending order
-                } else {
-                    // If types are different, prioritize integers over strings
-                    return a.containsInt();
-                }
-            });
+/**
+ * Reads the value of the --seed option.
+ * 
+ * @param option The text after "--seed=".
+ * @return The seed, the program will error and end if it isn't a number.
+ */
+uint64_t parseSeed(const string& option){
+    uint64_t seed = 0;
+    auto result = from_chars(option.data(), option.data() + option.size(), seed);
+    if (option.empty() || result.ec != errc() || result.ptr != option.data() + option.size()) error_handler.unknownOption("--seed=" + option);
+    return seed;
+}
 
-            // Push sorted elements back to the queue
-            for (const auto &elem : temp_vector) {
-                program_queue.push(elem);
-            }
-        }
+/**
+ * Reads the value of the -j option.
+ * 
+ * @param option The text after "-j" or "--jobs=", or the argument after "-j".
+ * @return The number of programs to run at once, the program will error and end if it isn't a positive number.
+ */
+unsigned parseJobs(const string& option){
+    unsigned jobs = 0;
+    auto result = from_chars(option.data(), option.data() + option.size(), jobs);
+    if (option.empty() || result.ec != errc() || result.ptr != option.data() + option.size() || jobs == 0) error_handler.unknownOption("-j" + option);
+    return jobs;
+}
 
+/**
+ * Writes the profile collected by --profile: a report to stderr, and everything as JSON to the profile file.
+ * Registered with atexit, so a program that ends on an error is still profiled up to that point.
+ */
+void writeProfile(){
+    program_profiler.stop();
+    program_output.flush();
+    program_profiler.writeReport(stderr);
+    FILE* json_file = fopen(profile_path.c_str(), "w");
+    if (json_file == nullptr) {
+        cerr << "Could not write profile to: " << profile_path << endl;
+        return;
     }
+    program_profiler.writeJson(json_file);
+    fclose(json_file);
+}
 
-
-    return 0;
+/**
+ * Writes the runtime metrics for --metrics, registered with atexit so they are written however the program ends.
+ */
+void writeMetrics(){
+    program_output.flush();
+    RuntimeMetrics::writeToDestination(interpreter.queue());
 }
 
 /**
- * Checks if a given string is an integer
+ * Gets the compiled form of a program, from the cache if it has been compiled before, or by compiling it and caching the result.
  * 
- * @param str The given string
- * @return true if the string is an integer, false otherwise
+ * @param source The text of the program.
+ * @param source_hash The hash of the text, which the cache is keyed on.
+ * @param optimization_level How far to optimize the program, 0 to not optimize it.
+ * @param use_cache Whether to look in and write to the cache at all.
+ * @return The compiled program, the program will error and end if it doesn't compile.
  */
-bool isInteger(string str){
-    try{
-        stoi(str);
-        return true;
-    } catch (...) {
-        return false;
+Program loadProgram(const SourceFile& source, uint64_t source_hash, int optimization_level, bool use_cache){
+    string cache_path = use_cache ? BytecodeFile::cachePath(source_hash, optimization_level) : string();
+    Program program;
+    if (!cache_path.empty()) {
+        SourceFile cached;
+        uint64_t cached_hash = 0;
+        if (cached.open(cache_path) && BytecodeFile::load(cached.text(), program, cached_hash)
+            && cached_hash == source_hash && program.optimization_level == optimization_level) return program;
     }
+
+    // Decode and link every line once, so the executor never has to look at the text again.
+    program = Compiler::compile(source.lines(), error_handler);
+    Optimizer::optimize(program, optimization_level);
+    if (!cache_path.empty()) BytecodeFile::save(program, source_hash, cache_path); // A cache that can't be written only costs time.
+    return program;
 }
 
 /**
- * Compares the first two elements of a queue
+ * The actual run section of the program for the interpreter.
  * 
- * @param program_queue The queue of the program itself
- * @param comparisonType The type of comparison to check for
- * @param line The line the comparsion happens at, for error handling.
- * @return the result of the comparison
+ * @param program The compiled program.
+ * @param dispatch_mode How the interpreter moves from one instruction to the next.
+ * @param verbose Whether to print debugging output while the program runs.
+ * @param jit Whether to compile hot loops to native code, where that is supported.
+ * @return The value returned by RET, or 0 if the program ran off its end.
  */
-bool compareFirstTwo(const std::queue<node>& program_queue, string comparisonType, int line) {
-    // Make a copy of the queue
-    std::queue<node> temp_queue = program_queue;
-
-    // Check if there are at least two elements in the queue
-    if (temp_queue.size() < 2) {
-        error_handler.notEnoughArguments(line);
+int run(Program& program, DispatchMode dispatch_mode, bool verbose, bool jit){
+    // This is just for debug
+    if (verbose) cout << "Output Start: " << endl;
+
+    interpreter.setDispatchMode(dispatch_mode);
+    interpreter.setVerbose(verbose);
+    interpreter.setJit(jit);
+    if (!profile_path.empty()) {
+        atexit(writeProfile);
+        interpreter.setProfiler(&program_profiler);
     }
+    interpreter.load(std::move(program));
 
-    // Access the first element
-    node first_element = temp_queue.front();
-
-    // Dequeue the first element
-    temp_queue.pop();
-
-    // Access the second element
-    node second_element = temp_queue.front();
-
-    // Check the comparison type and compare
-    if(comparisonType == ">"){
-        if(first_element.getInt() > second_element.getInt()) return true;
-        else return false;
-    } else if(comparisonType == "<"){
-        if(first_element.getInt() < second_element.getInt()) return true;
-        else return false;
-    } else if(comparisonType == "=="){
-        if(first_element.getInt() == second_element.getInt()) return true;
-        else return false;
-    } else if(comparisonType == "!="){
-        if(first_element.getInt() != second_element.getInt()) return true;
-        else return false;
-    } else {
-        error_handler.unspecifiedComparisonOperation(line);
+    // Run the code for real this time.
+    int result = interpreter.run(program_input, program_output);
+    if (interpreter.failed()) {
+        program_output.drain(); // What the program printed comes before the error that stopped it.
+        interpreter.reportError();
+        return -1;
     }
-
-    return false; // Something went wrong with the comparison
-}
\ No newline at end of file
+    return result;
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/**
+ * A double-ended queue stored in a power-of-two ring buffer.
+ * Pushing to either end, popping the front and peeking at any index are all O(1).
+ * The buffer doubles when it is full and halves once it is only a quarter full, so a burst of pushes doesn't hold on to its memory
+ * and a queue hovering around a boundary doesn't keep reallocating.
+ */
+template <typename T>
+class RingQueue {
+private:
+    static constexpr size_t MIN_CAPACITY = 16;
+
+    std::vector<T> slots; // Always a power of two in size.
+    size_t head = 0;      // The slot holding the front element.
+    size_t count = 0;     // The number of elements in the queue.
+    size_t peak = 0;      // The most elements the queue has held at once.
+    size_t resizes = 0;   // How many times the buffer has been reallocated.
+
+    // Copies of whole queues made by the current thread.
+    static size_t& copyCount() {
+        static thread_local size_t copies = 0;
+        return copies;
+    }
+
+    size_t mask() const { return slots.size() - 1; }
+
+    /**
+     * Moves every element into a buffer of a new size, with the front element in the first slot.
+     *
+     * @param capacity The new size of the buffer, a power of two that can hold every element.
+     */
+    void resize(size_t capacity) {
+        std::vector<T> resized(capacity);
+        for (size_t i = 0; i < count; i++) resized[i] = std::move(slots[(head + i) & mask()]);
+        slots.swap(resized);
+        head = 0;
+        resizes++;
+    }
+
+    void growIfFull() {
+        if (count == slots.size()) resize(slots.size() * 2);
+        if (count >= peak) peak = count + 1;
+    }
+
+    void shrinkIfSparse() {
+        if (slots.size() > MIN_CAPACITY && count <= slots.size() / 4) resize(slots.size() / 2);
+    }
+
+    /**
+     * Makes this a new empty queue, for the queue whose buffer was moved away.
+     */
+    void reset() {
+        std::vector<T>(MIN_CAPACITY).swap(slots);
+        head = 0;
+        count = 0;
+        peak = 0;
+        resizes = 0;
+    }
+
+public:
+    RingQueue() : slots(MIN_CAPACITY) {}
+    RingQueue(const RingQueue& other)
+        : slots(other.slots), head(other.head), count(other.count), peak(other.peak), resizes(other.resizes) { copyCount()++; }
+    // A moved-from queue is left empty and ready to use, rather than with a count that its empty buffer doesn't match.
+    RingQueue(RingQueue&& other) noexcept
+        : slots(std::move(other.slots)), head(other.head), count(other.count), peak(other.peak), resizes(other.resizes) {
+        other.reset();
+    }
+
+    RingQueue& operator=(RingQueue&& other) noexcept {
+        if (this != &other) {
+            slots = std::move(other.slots);
+            head = other.head;
+            count = other.count;
+            peak = other.peak;
+            resizes = other.resizes;
+            other.reset();
+        }
+        return *this;
+    }
+
+    RingQueue& operator=(const RingQueue& other) {
+        if (this != &other) {
+            slots = other.slots;
+            head = other.head;
+            count = other.count;
+            peak = other.peak;
+            resizes = other.resizes;
+            copyCount()++;
+        }
+        return *this;
+    }
+
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+    size_t capacity() const { return slots.size(); }
+    size_t peakSize() const { return peak; }
+    size_t resizeCount() const { return resizes; }
+
+    /**
+     * Gets how many times a whole queue of this type has been copied by the current thread.
+     *
+     * @return The number of copies.
+     */
+    static size_t copies() { return copyCount(); }
+
+    T& front() { return slots[head]; }
+    const T& front() const { return slots[head]; }
+
+    /**
+     * Gets an element without removing it.
+     *
+     * @param index The position of the element, 0 being the front of the queue.
+     * @return The element.
+     */
+    T& peek(size_t index) { return slots[(head + index) & mask()]; }
+    const T& peek(size_t index) const { return slots[(head + index) & mask()]; }
+
+    /**
+     * Adds an element to the back of the queue.
+     *
+     * @param value The element.
+     */
+    void push(T value) {
+        growIfFull();
+        slots[(head + count) & mask()] = std::move(value);
+        count++;
+    }
+
+    /**
+     * Adds an element to the front of the queue.
+     *
+     * @param value The element.
+     */
+    void pushFront(T value) {
+        growIfFull();
+        head = (head - 1) & mask();
+        slots[head] = std::move(value);
+        count++;
+    }
+
+    /**
+     * Removes the front element of the queue.
+     */
+    void pop() {
+        slots[head] = T(); // Release anything the element owns now rather than when the slot is reused.
+        head = (head + 1) & mask();
+        count--;
+        shrinkIfSparse();
+    }
+
+    /**
+     * Rearranges the buffer so the elements sit in order in one contiguous block, for algorithms that work in place on an array.
+     *
+     * @return The front element, followed by the rest of the queue.
+     */
+    T* linearize() {
+        if (head + count > slots.size()) {
+            std::rotate(slots.begin(), slots.begin() + head, slots.end());
+            head = 0;
+        }
+        return slots.data() + head;
+    }
+
+    /**
+     * Counts the peak size and the resizes of another queue as this queue's own, when the elements spent a while in the other.
+     *
+     * @param other The other queue.
+     */
+    template <typename U>
+    void absorbStats(const RingQueue<U>& other) {
+        peak = std::max(peak, other.peakSize());
+        resizes += other.resizeCount();
+    }
+
+    /**
+     * Removes every element and gives back the memory of the buffer.
+     */
+    void clear() {
+        std::vector<T>(MIN_CAPACITY).swap(slots);
+        head = 0;
+        count = 0;
+    }
+};
@@ -0,0 +1,69 @@
+#include "randomSource.h"
+
+#include <chrono>
+#include <random>
+
+using namespace std;
+
+/**
+ * Creates a generator.
+ *
+ * @param seed The seed, the same seed always gives the same numbers.
+ */
+RandomSource::RandomSource(uint64_t seed) {
+    this->seed(seed);
+}
+
+/**
+ * Makes up a seed for runs that weren't given one.
+ *
+ * @return A seed that is different on every run.
+ */
+uint64_t RandomSource::systemSeed() {
+    random_device device;
+    uint64_t seed = (uint64_t(device()) << 32) ^ device();
+    return seed ^ static_cast<uint64_t>(chrono::steady_clock::now().time_since_epoch().count());
+}
+
+/**
+ * Restarts the generator from a seed.
+ * The seed is spread over the whole state with splitmix64, so similar seeds still give unrelated numbers.
+ *
+ * @param seed The seed.
+ */
+void RandomSource::seed(uint64_t seed) {
+    for (uint64_t& word : state) {
+        seed += 0x9E3779B97F4A7C15;
+        uint64_t mixed = seed;
+        mixed = (mixed ^ (mixed >> 30)) * 0xBF58476D1CE4E5B9;
+        mixed = (mixed ^ (mixed >> 27)) * 0x94D049BB133111EB;
+        word = mixed ^ (mixed >> 31);
+    }
+}
+
+/**
+ * Gets a random number below a bound, without the bias of taking the remainder.
+ * The 64 random bits are scaled up to the bound with a 128 bit multiply, and the few results that would make some numbers more likely are drawn again.
+ *
+ * @param bound One more than the largest number wanted, must not be 0.
+ * @return A number from 0 to bound - 1.
+ */
+uint64_t RandomSource::below(uint64_t bound) {
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 product = static_cast<unsigned __int128>(next()) * bound;
+    uint64_t low = static_cast<uint64_t>(product);
+    if (low < bound) {
+        uint64_t threshold = (0 - bound) % bound;
+        while (low < threshold) {
+            product = static_cast<unsigned __int128>(next()) * bound;
+            low = static_cast<uint64_t>(product);
+        }
+    }
+    return static_cast<uint64_t>(product >> 64);
+#else
+    uint64_t threshold = (0 - bound) % bound;
+    uint64_t value = next();
+    while (value < threshold) value = next();
+    return value % bound;
+#endif
+}
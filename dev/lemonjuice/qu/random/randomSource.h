@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+/**
+ * The interpreter's source of random numbers, a xoshiro256** generator.
+ * It is seeded once per run, either from the --seed option so a run can be repeated exactly, or from the system otherwise.
+ */
+class RandomSource {
+private:
+    uint64_t state[4];
+
+    static uint64_t rotate(uint64_t value, int bits) { return (value << bits) | (value >> (64 - bits)); }
+public:
+    explicit RandomSource(uint64_t seed);
+    static uint64_t systemSeed();
+
+    void seed(uint64_t seed);
+
+    /**
+     * Gets the next 64 random bits.
+     *
+     * @return The bits.
+     */
+    uint64_t next() {
+        uint64_t result = rotate(state[1] * 5, 7) * 9;
+        uint64_t shifted = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= shifted;
+        state[3] = rotate(state[3], 45);
+        return result;
+    }
+
+    uint64_t below(uint64_t bound);
+
+    /**
+     * Shuffles an array in place, every order being equally likely.
+     *
+     * @param first The first element of the array.
+     * @param count The number of elements in the array.
+     */
+    template <typename T>
+    void shuffle(T* first, size_t count) {
+        for (size_t i = count; i > 1; i--) {
+            using std::swap;
+            swap(first[i - 1], first[below(i)]);
+        }
+    }
+};
@@ -0,0 +1,133 @@
+#include "sortEngine.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Sorts an array of nodes in place.
+ *
+ * @param first The first node of the array.
+ * @param count The number of nodes in the array.
+ * @param ascending true for SORTUP, false for SORTDOWN.
+ */
+void SortEngine::sort(node* first, size_t count, bool ascending) {
+    if (count < 2) return;
+    node* strings = partition(first, first + count, [](const node& element) { return element.containsInt(); });
+    sortInts(first, strings - first, ascending);
+    sortStrings(strings, first + count - strings, ascending);
+}
+
+/**
+ * Sorts an array of plain integers in place, for the integer engine's queue.
+ *
+ * @param first The first integer of the array.
+ * @param count The number of integers in the array.
+ * @param ascending true for SORTUP, false for SORTDOWN.
+ */
+void SortEngine::sort(int64_t* first, size_t count, bool ascending) {
+    if (count < 2) return;
+    vector<uint64_t> keys(count);
+    for (size_t i = 0; i < count; i++) keys[i] = static_cast<uint64_t>(first[i]) ^ SIGN_BIT;
+    radixSort(keys);
+    for (size_t i = 0; i < count; i++) first[i] = static_cast<int64_t>(keys[ascending ? i : count - 1 - i] ^ SIGN_BIT);
+}
+
+/**
+ * Sorts keys into their unsigned order with an LSD radix sort, one byte at a time.
+ * Bytes that are the same in every key are skipped, so small numbers only take a pass or two.
+ *
+ * @param keys The keys, at least one of them.
+ */
+void SortEngine::radixSort(vector<uint64_t>& keys) {
+    size_t count = keys.size();
+    vector<uint64_t> scratch(count);
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t counts[256] = {};
+        for (uint64_t key : keys) counts[(key >> shift) & 0xFF]++;
+        if (counts[(keys[0] >> shift) & 0xFF] == count) continue;
+
+        size_t offset = 0;
+        for (size_t& bucket : counts) {
+            size_t bucket_size = bucket;
+            bucket = offset;
+            offset += bucket_size;
+        }
+        for (uint64_t key : keys) scratch[counts[(key >> shift) & 0xFF]++] = key;
+        keys.swap(scratch);
+    }
+}
+
+/**
+ * Sorts an array of integer nodes with a radix sort on their values.
+ *
+ * @param first The first node of the array.
+ * @param count The number of nodes in the array.
+ * @param ascending true for smallest first, false for largest first.
+ */
+void SortEngine::sortInts(node* first, size_t count, bool ascending) {
+    if (count < 2) return;
+    vector<uint64_t> keys(count);
+    for (size_t i = 0; i < count; i++) keys[i] = static_cast<uint64_t>(first[i].getInt()) ^ SIGN_BIT;
+    radixSort(keys);
+
+    for (size_t i = 0; i < count; i++) {
+        uint64_t key = keys[ascending ? i : count - 1 - i];
+        first[i] = node(static_cast<int64_t>(key ^ SIGN_BIT));
+    }
+}
+
+/**
+ * Sorts an array of string nodes by their text.
+ * Large arrays are cut into one run per hardware thread, the runs are sorted at the same time and then merged in pairs,
+ * each level of merges also running at the same time.
+ *
+ * @param first The first node of the array.
+ * @param count The number of nodes in the array.
+ * @param ascending true for A to Z, false for Z to A.
+ */
+void SortEngine::sortStrings(node* first, size_t count, bool ascending) {
+    if (count < 2) return;
+
+    // Looking at a rope joins its pieces, so do that for every string up front and the comparisons only ever read.
+    for (size_t i = 0; i < count; i++) first[i].stringView();
+
+    auto before = [ascending](const node& a, const node& b) {
+        return ascending ? a.stringView() < b.stringView() : b.stringView() < a.stringView();
+    };
+
+    size_t threads = thread::hardware_concurrency();
+    if (count < PARALLEL_THRESHOLD || threads < 2) {
+        std::sort(first, first + count, before);
+        return;
+    }
+
+    // Run boundaries, run i being [bounds[i], bounds[i + 1]).
+    threads = min(threads, count / (PARALLEL_THRESHOLD / 4));
+    vector<size_t> bounds;
+    for (size_t i = 0; i <= threads; i++) bounds.push_back(count * i / threads);
+
+    vector<thread> workers;
+    for (size_t i = 0; i + 1 < bounds.size(); i++) {
+        workers.emplace_back([&, i] { std::sort(first + bounds[i], first + bounds[i + 1], before); });
+    }
+    for (thread& worker : workers) worker.join();
+
+    while (bounds.size() > 2) {
+        vector<size_t> merged;
+        workers.clear();
+        for (size_t i = 0; i + 1 < bounds.size(); i += 2) {
+            merged.push_back(bounds[i]);
+            if (i + 2 >= bounds.size()) break;
+            workers.emplace_back([&, i] {
+                inplace_merge(first + bounds[i], first + bounds[i + 1], first + bounds[i + 2], before);
+            });
+        }
+        merged.push_back(bounds.back());
+        for (thread& worker : workers) worker.join();
+        bounds.swap(merged);
+    }
+}
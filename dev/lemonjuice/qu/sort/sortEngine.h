@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "../node/node.h"
+
+/**
+ * Sorts the elements of the queue for SORTUP and SORTDOWN.
+ * Integers always come before strings, whichever way the queue is sorted, so the elements are split into the two kinds once
+ * and each kind is sorted with an algorithm of its own: a radix sort on the integer values, and a comparison sort on the
+ * strings that moves the 16 byte nodes around rather than the characters.
+ */
+class SortEngine {
+private:
+    // Below this many strings a single thread sorts them, above it the work is split into a parallel merge sort.
+    static constexpr size_t PARALLEL_THRESHOLD = 1 << 16;
+    // Flipping the sign bit makes the unsigned order of the keys the signed order of the values.
+    static constexpr uint64_t SIGN_BIT = uint64_t(1) << 63;
+
+    static void radixSort(std::vector<uint64_t>& keys);
+
+    static void sortInts(node* first, size_t count, bool ascending);
+    static void sortStrings(node* first, size_t count, bool ascending);
+public:
+    static void sort(node* first, size_t count, bool ascending);
+    static void sort(int64_t* first, size_t count, bool ascending);
+};
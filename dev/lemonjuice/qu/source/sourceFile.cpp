@@ -0,0 +1,105 @@
+#include "sourceFile.h"
+
+#include <fstream>
+#include <iterator>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+SourceFile::~SourceFile() {
+    unmap();
+}
+
+/**
+ * Maps a file into memory.
+ * Where mapping isn't possible (an empty file, a pipe, or a system without mmap) the file is read in one go instead.
+ *
+ * @param path The path of the file.
+ * @return true if the file was loaded, false if it couldn't be opened.
+ */
+bool SourceFile::open(const string& path) {
+    unmap();
+    fallback.clear();
+    line_index.clear();
+    indexed = false;
+
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void* mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            data = static_cast<const char*>(mapping);
+            size = static_cast<size_t>(info.st_size);
+            mapped = true;
+#ifdef MADV_SEQUENTIAL
+            madvise(mapping, size, MADV_SEQUENTIAL);
+#endif
+        }
+    }
+    close(fd);
+#endif
+
+    if (!mapped) {
+        ifstream file(path, ios::in | ios::binary);
+        if (!file.is_open()) return false;
+        fallback.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        data = fallback.data();
+        size = fallback.size();
+    }
+
+    return true;
+}
+
+/**
+ * Splits the text into lines the way getline would: on '\n', with no empty line after a final newline.
+ */
+void SourceFile::indexLines() const {
+    string_view remaining(data, size);
+    while (!remaining.empty()) {
+        size_t newline = remaining.find('\n');
+        if (newline == string_view::npos) {
+            line_index.push_back(remaining);
+            break;
+        }
+        line_index.push_back(remaining.substr(0, newline));
+        remaining.remove_prefix(newline + 1);
+    }
+}
+
+void SourceFile::unmap() {
+#ifndef _WIN32
+    if (mapped) munmap(const_cast<char*>(data), size);
+#endif
+    mapped = false;
+    data = nullptr;
+    size = 0;
+}
+
+/**
+ * Gets the lines of the file, without their newlines.
+ *
+ * @return The lines, pointing into the file's contents.
+ */
+const vector<string_view>& SourceFile::lines() const {
+    if (!indexed) {
+        indexLines();
+        indexed = true;
+    }
+    return line_index;
+}
+
+/**
+ * Gets the whole contents of the file.
+ *
+ * @return The contents.
+ */
+string_view SourceFile::text() const {
+    return string_view(data, size);
+}
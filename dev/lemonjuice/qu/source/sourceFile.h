@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * The contents of a program or bytecode file, mapped straight into memory and split into lines without copying any of it.
+ * The lines point into the mapping, so they are only valid while the SourceFile is.
+ */
+class SourceFile {
+private:
+    const char* data = nullptr; // The contents of the file.
+    size_t size = 0;
+    bool mapped = false;        // True if data is a memory mapping, false if it was read into fallback.
+    std::string fallback;       // Holds the contents when the file can't be mapped.
+    mutable std::vector<std::string_view> line_index; // Built the first time the lines are asked for.
+    mutable bool indexed = false;
+
+    void indexLines() const;
+    void unmap();
+public:
+    SourceFile() = default;
+    ~SourceFile();
+    SourceFile(const SourceFile&) = delete;
+    SourceFile& operator=(const SourceFile&) = delete;
+
+    bool open(const std::string& path);
+    const std::vector<std::string_view>& lines() const;
+    std::string_view text() const;
+};
@@ -0,0 +1,348 @@
+#include "cppTranspiler.h"
+
+#include <vector>
+#include "../analysis/typeInference.h"
+#include "../compiler/compiler.h"
+#include "../output/queueWriter.h"
+
+using namespace std;
+
+// Everything a translated program needs besides its main function and its queue: the same globals as the interpreter.
+static const char* const PREAMBLE = R"(#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include "error/errorHandler.h"
+#include "input/inputReader.h"
+#include "node/node.h"
+#include "operation/operationHandler.h"
+#include "output/outputSink.h"
+#include "output/queueWriter.h"
+#include "queue/ringQueue.h"
+#include "random/randomSource.h"
+#include "sort/sortEngine.h"
+
+static errorHandler error_handler(ErrorPolicy::Return); // Errors are kept, for fail to report after the output before them.
+static OutputSink program_output(stdout);
+static RandomSource program_random(RandomSource::systemSeed());
+
+// Ends the program on the error just reported, once everything it printed before the error is written, as qu does.
+[[noreturn]] static void fail() {
+    program_output.drain();
+    error_handler.report();
+    std::exit(-1);
+}
+
+enum class Comparison { Equal, Greater, Less, NotEqual };
+
+)";
+
+// The queue of nodes, and the few pieces of the execution loop that aren't already functions of their own.
+static const char* const NODE_PREAMBLE = R"(static RingQueue<node> program_queue;
+static InputReader program_input(0);
+
+static inline bool compareFirstTwo(Comparison comparison, int line) {
+    if (program_queue.size() < 2) {
+        error_handler.notEnoughArguments(line);
+        fail();
+    }
+    int order = program_queue.peek(0).compare(program_queue.peek(1));
+    switch (comparison) {
+        case Comparison::Equal: return order == 0;
+        case Comparison::Greater: return order > 0;
+        case Comparison::Less: return order < 0;
+        case Comparison::NotEqual: return order != 0;
+    }
+    return false;
+}
+
+static inline void printFront(int line, bool new_line, bool pop) {
+    if (program_queue.empty()) {
+        error_handler.notEnoughArguments(line);
+        fail();
+    }
+    if (new_line) program_queue.front().p_println(program_output);
+    else program_queue.front().p_print(program_output);
+    if (pop) program_queue.pop();
+}
+
+static inline void printAll(bool new_line) {
+    while (!program_queue.empty()) {
+        if (new_line) program_queue.front().p_println(program_output);
+        else program_queue.front().p_print(program_output);
+        program_queue.pop();
+    }
+}
+
+static inline void read(std::string_view prompt, bool all) {
+    program_output.write(prompt);
+    program_output.endPrompt();
+    std::string_view line;
+    if (all) {
+        while (program_input.readLine(line)) program_queue.push(InputReader::toNode(line));
+    }
+    else {
+        if (!program_input.readLine(line)) line = std::string_view();
+        program_queue.push(InputReader::toNode(line));
+    }
+}
+
+static inline int ret(int line) {
+    if (program_queue.empty()) {
+        error_handler.returnFromEmptyQueue(line);
+        fail();
+    }
+    node front_node = program_queue.front();
+    program_queue.pop();
+    if (!front_node.containsInt()) {
+        error_handler.nonIntegerReturnValue(line);
+        fail();
+    }
+    return static_cast<int>(front_node.getInt());
+}
+
+)";
+
+// The queue of plain integers for a program TypeInference has proved never makes a string, with every instruction done inline
+// on it as the IntExecutor does, reporting the same errors.
+static const char* const INT_PREAMBLE = R"(static RingQueue<int64_t> program_queue;
+
+static inline void enoughArguments(size_t count, int line) {
+    if (program_queue.size() < count) {
+        error_handler.notEnoughArguments(line);
+        fail();
+    }
+}
+
+enum class Operation { Add, Sub, Mul, Div, Mod };
+
+// The K forms keep their operands, the rest pop both of them before a division by zero is reported.
+static inline void arithmetic(Operation operation, bool keeps_operands, int line) {
+    enoughArguments(2, line);
+    int64_t first = program_queue.peek(0);
+    int64_t second = program_queue.peek(1);
+    if (!keeps_operands) {
+        program_queue.pop();
+        program_queue.pop();
+    }
+    if ((operation == Operation::Div || operation == Operation::Mod) && second == 0) {
+        error_handler.divisionByZero(line);
+        fail();
+    }
+    switch (operation) {
+        case Operation::Add: program_queue.push(first + second); break;
+        case Operation::Sub: program_queue.push(first - second); break;
+        case Operation::Mul: program_queue.push(first * second); break;
+        case Operation::Div: program_queue.push(first / second); break;
+        case Operation::Mod: program_queue.push(first % second); break;
+    }
+}
+
+static inline bool compareFirstTwo(Comparison comparison, int line) {
+    enoughArguments(2, line);
+    int64_t first = program_queue.peek(0);
+    int64_t second = program_queue.peek(1);
+    switch (comparison) {
+        case Comparison::Equal: return first == second;
+        case Comparison::Greater: return first > second;
+        case Comparison::Less: return first < second;
+        case Comparison::NotEqual: return first != second;
+    }
+    return false;
+}
+
+static inline void printFront(int line, bool new_line, bool pop) {
+    enoughArguments(1, line);
+    program_output.writeInt(program_queue.front());
+    if (new_line) program_output.endLine();
+    if (pop) program_queue.pop();
+}
+
+static inline void printAll(bool new_line) {
+    while (!program_queue.empty()) {
+        program_output.writeInt(program_queue.front());
+        if (new_line) program_output.endLine();
+        program_queue.pop();
+    }
+}
+
+static inline int ret(int line) {
+    if (program_queue.empty()) {
+        error_handler.returnFromEmptyQueue(line);
+        fail();
+    }
+    int64_t value = program_queue.front();
+    program_queue.pop();
+    return static_cast<int>(value);
+}
+
+)";
+
+/**
+ * Writes a string as a C++ string literal, escaping anything that isn't printable ASCII.
+ *
+ * @param text The string.
+ * @return The literal, quotes included.
+ */
+string CppTranspiler::stringLiteral(string_view text) {
+    static const char* const DIGITS = "01234567";
+    string literal = "\"";
+    for (char c : text) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            literal += '\\';
+            literal += c;
+        }
+        else if (byte >= 0x20 && byte < 0x7F && c != '?') literal += c; // '?' is escaped too, so no trigraph is ever formed.
+        else {
+            // Always three octal digits, so the escape can't run into a digit after it.
+            literal += '\\';
+            literal += DIGITS[byte >> 6];
+            literal += DIGITS[(byte >> 3) & 7];
+            literal += DIGITS[byte & 7];
+        }
+    }
+    return literal + "\"";
+}
+
+/**
+ * Writes an integer as a C++ expression of type int64_t.
+ *
+ * @param value The integer.
+ * @return The expression.
+ */
+string CppTranspiler::intLiteral(int64_t value) {
+    // The smallest integer has no literal of its own, its magnitude doesn't fit in an int64_t.
+    if (value == INT64_MIN) return "(INT64_C(-9223372036854775807) - 1)";
+    return "INT64_C(" + to_string(value) + ")";
+}
+
+/**
+ * Translates a compiled program into C++.
+ *
+ * @param program The compiled program, optimized or not.
+ * @param source_name The file the program came from, for the header comment.
+ * @return The text of the C++ source file.
+ */
+string CppTranspiler::translate(const Program& program, const string& source_name) {
+    bool integer_only = TypeInference::integerOnly(program);
+    // Only jump targets get a label, so the C++ compiler doesn't warn about the rest.
+    vector<bool> targets(program.code.size(), false);
+    for (const Instruction& instruction : program.code) {
+        if (Compiler::isJump(instruction.opcode)) targets[instruction.int_operand] = true;
+    }
+
+    string cpp = "// Translated from " + source_name + " by qu --emit-cpp, changes to it belong in the .qu program.\n";
+    cpp += "// Build with: g++ -std=c++17 -O3 -I <qu directory> <this file> <build>/libqu.a -pthread\n\n";
+    cpp += PREAMBLE;
+    cpp += integer_only ? INT_PREAMBLE : NODE_PREAMBLE;
+    cpp += "int main() {\n";
+    for (size_t index = 0; index < program.code.size(); index++) {
+        const Instruction& instruction = program.code[index];
+        string line = to_string(instruction.line);
+        if (targets[index]) cpp += "instruction_" + to_string(index) + ":\n";
+        if (instruction.opcode != Opcode::Halt) cpp += "    // " + to_string(instruction.line + 1) + ": " + Compiler::opcodeName(instruction.opcode) + "\n";
+
+        string operation;
+        string comparison;
+        bool keeps_operands = false;
+        switch (instruction.opcode) {
+            case Opcode::AddK: keeps_operands = true; [[fallthrough]];
+            case Opcode::Add: case Opcode::PushAdd: operation = "Add"; break;
+            case Opcode::DivK: keeps_operands = true; [[fallthrough]];
+            case Opcode::Div: case Opcode::PushDiv: operation = "Div"; break;
+            case Opcode::ModK: keeps_operands = true; [[fallthrough]];
+            case Opcode::Mod: case Opcode::PushMod: operation = "Mod"; break;
+            case Opcode::MulK: keeps_operands = true; [[fallthrough]];
+            case Opcode::Mul: case Opcode::PushMul: operation = "Mul"; break;
+            case Opcode::SubK: keeps_operands = true; [[fallthrough]];
+            case Opcode::Sub: case Opcode::PushSub: operation = "Sub"; break;
+            case Opcode::IfEq: case Opcode::IfEqGoto: comparison = "Equal"; break;
+            case Opcode::IfGt: case Opcode::IfGtGoto: comparison = "Greater"; break;
+            case Opcode::IfLt: case Opcode::IfLtGoto: comparison = "Less"; break;
+            case Opcode::IfNq: case Opcode::IfNqGoto: comparison = "NotEqual"; break;
+            default: break;
+        }
+
+        // An integer goes on the queue as it is, or in a node.
+        string value = integer_only ? intLiteral(instruction.int_operand) : "node(" + intLiteral(instruction.int_operand) + ")";
+        switch (instruction.opcode) {
+            case Opcode::PushAdd: case Opcode::PushSub: case Opcode::PushMul: case Opcode::PushDiv: case Opcode::PushMod:
+                cpp += "    program_queue.push(" + value + ");\n";
+                [[fallthrough]]; // Then the operation itself.
+            case Opcode::Add: case Opcode::AddK: case Opcode::Div: case Opcode::DivK: case Opcode::Mod: case Opcode::ModK:
+            case Opcode::Mul: case Opcode::MulK: case Opcode::Sub: case Opcode::SubK:
+                if (integer_only) cpp += "    arithmetic(Operation::" + operation + ", " + (keeps_operands ? "true, " : "false, ") + line + ");\n";
+                else cpp += "    if (!OperationHandler::qu" + operation + (keeps_operands ? "K" : "") + "(program_queue, " + line + ", error_handler)) fail();\n";
+                break;
+            case Opcode::Empty:
+                break;
+            case Opcode::Goto:
+                cpp += "    goto instruction_" + to_string(instruction.int_operand) + ";\n";
+                break;
+            case Opcode::IfEq: case Opcode::IfGt: case Opcode::IfLt: case Opcode::IfNq:
+                cpp += "    if (compareFirstTwo(Comparison::" + comparison + ", " + line + ")) goto instruction_" + to_string(instruction.int_operand) + ";\n";
+                break;
+            case Opcode::IfEqGoto: case Opcode::IfGtGoto: case Opcode::IfLtGoto: case Opcode::IfNqGoto:
+                cpp += "    if (compareFirstTwo(Comparison::" + comparison + ", " + line + ")) goto instruction_" + to_string(instruction.int_operand) + ";\n";
+                cpp += "    goto instruction_" + to_string(program.code[index + 1].int_operand) + ";\n";
+                break;
+            case Opcode::Peek: cpp += "    printFront(" + line + ", false, false);\n"; break;
+            case Opcode::PeekLn: cpp += "    printFront(" + line + ", true, false);\n"; break;
+            case Opcode::Pop: cpp += "    printFront(" + line + ", false, true);\n"; break;
+            case Opcode::PopLn: cpp += "    printFront(" + line + ", true, true);\n"; break;
+            case Opcode::PopAll: cpp += "    printAll(false);\n"; break;
+            case Opcode::PopAllLn: cpp += "    printAll(true);\n"; break;
+            case Opcode::Poke:
+                cpp += "    program_random.shuffle(program_queue.linearize(), program_queue.size());\n";
+                break;
+            case Opcode::Print: {
+                const string& text = program.strings[instruction.int_operand];
+                cpp += "    program_output.write(std::string_view(" + stringLiteral(text) + ", " + to_string(text.size()) + "));\n";
+                cpp += "    program_output.endLine();\n";
+                break;
+            }
+            case Opcode::PushInt:
+                cpp += "    program_queue.push(" + value + ");\n";
+                break;
+            case Opcode::PushString: {
+                // Only where TypeInference found it can never be reached, as in the IntExecutor.
+                if (integer_only) {
+                    cpp += "    error_handler.unknownInstruction(" + line + ");\n    fail();\n";
+                    break;
+                }
+                const string& text = program.strings[instruction.int_operand];
+                cpp += "    program_queue.push(node(std::string(" + stringLiteral(text) + ", " + to_string(text.size()) + ")));\n";
+                break;
+            }
+            case Opcode::QDisplay:
+                cpp += "    QueueWriter::write(program_output, program_queue, DisplayFormat::";
+                cpp += static_cast<DisplayFormat>(instruction.int_operand) == DisplayFormat::Json ? "Json" : "List";
+                cpp += ");\n    program_output.endLine();\n";
+                break;
+            case Opcode::Read: case Opcode::ReadAll: {
+                if (integer_only) {
+                    cpp += "    error_handler.unknownInstruction(" + line + ");\n    fail();\n";
+                    break;
+                }
+                const string& prompt = program.strings[instruction.int_operand];
+                cpp += "    read(std::string_view(" + stringLiteral(prompt) + ", " + to_string(prompt.size()) + "), ";
+                cpp += instruction.opcode == Opcode::ReadAll ? "true);\n" : "false);\n";
+                break;
+            }
+            case Opcode::Ret:
+                cpp += "    return ret(" + line + ");\n";
+                break;
+            case Opcode::SortDown: case Opcode::SortUp:
+                cpp += "    SortEngine::sort(program_queue.linearize(), program_queue.size(), ";
+                cpp += instruction.opcode == Opcode::SortUp ? "true);\n" : "false);\n";
+                break;
+            case Opcode::Halt:
+                cpp += "    return 0;\n";
+                break;
+        }
+    }
+    cpp += "}\n";
+    return cpp;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "../compiler/instruction.h"
+
+/**
+ * Translates a compiled program into a C++ source file for --emit-cpp.
+ *
+ * The program becomes a single main function, one statement per instruction with a label on every jump target, calling the same
+ * OperationHandler, errorHandler, QueueWriter and SortEngine code the interpreter does. A program TypeInference proves only ever
+ * holds integers keeps them in a queue of plain int64_t instead, doing its arithmetic and comparisons inline as the IntExecutor
+ * does. The file is built against libqu:
+ *   qu --emit-cpp prog.qu > prog.cpp
+ *   g++ -std=c++17 -O3 -I <this directory> prog.cpp <build>/libqu.a -pthread -o prog
+ */
+class CppTranspiler {
+private:
+    static std::string stringLiteral(std::string_view text);
+    static std::string intLiteral(int64_t value);
+public:
+    static std::string translate(const Program& program, const std::string& source_name);
+};